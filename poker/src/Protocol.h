@@ -50,6 +50,7 @@ typedef enum {
 	SnapPlayerAction	= 0x0a,
 	SnapPlayerCurrent	= 0x0b,
 	SnapPlayerShow		= 0x0c,
+	SnapPlayerEquity	= 0x0d,  // betround, then cid:equity:tie per player (1/10000)
 	SnapFoyer		= 0x10,
 } snaptype;
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include "BoardContext.hpp"
+
+using namespace std;
+
+
+void BoardContext::clear()
+{
+	cards.clear();
+	cardcount = 0;
+	
+	hash = 0;
+	suits = 0;
+	face_mask = 0;
+	flush_suit = -1;
+	
+	for (unsigned int i=0; i < 4; i++)
+		suit_mask[i] = 0;
+	
+	for (unsigned int i=0; i < HandEvaluator::Faces; i++)
+		face_count[i] = 0;
+}
+
+void BoardContext::add(const Card &c)
+{
+	const unsigned int f = c.getFace() - Card::FirstFace;
+	const unsigned int s = c.getSuit() - Card::FirstSuit;
+	
+	cards.add(c);
+	cardcount++;
+	
+	hash += HandEvaluator::getFaceHash(c.getFace());
+	suits += 1 << (4*s);
+	suit_mask[s] |= 1 << f;
+	face_count[f]++;
+	face_mask |= 1 << f;
+	
+	// two hole-cards can only complete a flush with 3 or more suited board cards
+	if (getSuitCount(c.getSuit()) >= 3)
+		flush_suit = s;
+}
+
+void BoardContext::set(const CommunityCards *community)
+{
+	clear();
+	
+	CardSet board;
+	community->copyCards(&board);
+	
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+		for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		{
+			Card c((Card::Face)f, (Card::Suit)s);
+			if (board.contains(c))
+				add(c);
+		}
+}
+
+unsigned int BoardContext::evaluate(const Card &c1, const Card &c2) const
+{
+	if (cardcount + 2 < 5 || cardcount + 2 > 7)
+		return 0;
+	
+	if (flush_suit != -1)
+	{
+		unsigned int m = suit_mask[flush_suit];
+		
+		if (c1.getSuit() - Card::FirstSuit == flush_suit)
+			m |= 1 << (c1.getFace() - Card::FirstFace);
+		if (c2.getSuit() - Card::FirstSuit == flush_suit)
+			m |= 1 << (c2.getFace() - Card::FirstFace);
+		
+		if (CardSet::popcount(m) >= 5)
+			return HandEvaluator::lookupFlush(m);
+	}
+	
+	return HandEvaluator::lookupNoFlush(cardcount + 2,
+		hash + HandEvaluator::getFaceHash(c1.getFace()) + HandEvaluator::getFaceHash(c2.getFace()));
+}
+
+unsigned int BoardContext::evaluate(const HoleCards *hole) const
+{
+	Card c1, c2;
+	if (!hole->getCards(&c1, &c2))
+		return 0;
+	
+	return evaluate(c1, c2);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _BOARDCONTEXT_H
+#define _BOARDCONTEXT_H
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+#include "HoleCards.hpp"
+#include "CommunityCards.hpp"
+#include "HandEvaluator.hpp"
+
+/*
+	Pre-evaluated community cards. The context is extended street by
+	street, so evaluating a player's hand only folds in the two hole
+	cards. A copy extended by one more card (withCard) gives a what-if
+	evaluation of the next street.
+*/
+
+class BoardContext
+{
+public:
+	BoardContext() { clear(); };
+	
+	void clear();
+	void add(const Card &c);
+	void set(const CommunityCards *community);
+	
+	BoardContext withCard(const Card &c) const { BoardContext b = *this; b.add(c); return b; };
+	
+	unsigned int count() const { return cardcount; };
+	const CardSet& getCards() const { return cards; };
+	
+	unsigned int getFaceCount(Card::Face f) const { return face_count[f - Card::FirstFace]; };
+	unsigned int getSuitCount(Card::Suit s) const { return (suits >> (4 * (s - Card::FirstSuit))) & 0xf; };
+	unsigned int getFaceMask() const { return face_mask; };
+	int getFlushSuit() const { return flush_suit; };
+	
+	// strength key of the hole-cards on this board; 0 if less than 5 cards
+	unsigned int evaluate(const Card &c1, const Card &c2) const;
+	unsigned int evaluate(const HoleCards *hole) const;
+	
+private:
+	CardSet cards;
+	unsigned int cardcount;
+	
+	unsigned int hash;                             // sum of face hashes
+	unsigned int suits;                            // card count per suit; one nibble each
+	unsigned int suit_mask[4];                     // face mask per suit
+	unsigned char face_count[HandEvaluator::Faces];  // face histogram
+	unsigned int face_mask;                        // faces on board; for straights
+	
+	int flush_suit;  // the only suit which can still make a flush, or -1
+};
+
+#endif /* _BOARDCONTEXT_H */
@@ -24,84 +24,94 @@
 #include "Card.hpp"
 
 
-//static const char face_symbols[] = {
-//	'2', '3', '4', '5', '6', '7', '8', '9',
-//	'T', 'J', 'Q', 'K', 'A'
-//};
+const unsigned int Card::Count;
 
-static const char face_symbols[] = {
-	'6', '7', '8', '9',
+// all faces; the short deck uses Six to Ace
+static constexpr char face_symbols[] = {
+	'2', '3', '4', '5', '6', '7', '8', '9',
 	'T', 'J', 'Q', 'K', 'A'
 };
 
-
-static const char suit_symbols[] = {
+static constexpr char suit_symbols[] = {
 	'c', 'd', 'h', 's'
 };
 
 
-Card::Card()
+/* names of all cards and symbol lookups, built at compile time */
+struct NameTable {
+	char name[Card::Count][3];
+};
+
+struct SymbolTable {
+	unsigned char value[256];
+};
+
+static constexpr NameTable make_names()
 {
-	face = Card::FirstFace;
-	suit = Card::FirstSuit;
+	NameTable t {};
+	for (unsigned int i=0; i < Card::Count; i++)
+	{
+		t.name[i][0] = face_symbols[i / 4];
+		t.name[i][1] = suit_symbols[i % 4];
+		t.name[i][2] = '\0';
+	}
+	return t;
 }
 
-Card::Card(Face f, Suit s)
+// unknown symbols map to 'fallback'
+static constexpr SymbolTable make_lookup(const char *symbols, unsigned int count,
+	unsigned int first, unsigned int fallback)
 {
-	face = f;
-	suit = s;
+	SymbolTable t {};
+	for (unsigned int i=0; i < 256; i++)
+		t.value[i] = fallback;
+	for (unsigned int i=0; i < count; i++)
+		t.value[(unsigned char)symbols[i]] = first + i;
+	return t;
 }
 
+static constexpr NameTable card_names = make_names();
+static constexpr SymbolTable face_lookup =
+	make_lookup(face_symbols, sizeof(face_symbols), Card::Two, Card::FirstFace);
+static constexpr SymbolTable suit_lookup =
+	make_lookup(suit_symbols, sizeof(suit_symbols), Card::FirstSuit, Card::FirstSuit);
+
+
 Card::Card(const char *str)
+	: code(encode(convertFaceSymbol(str[0]), convertSuitSymbol(str[1])))
 {
-	face = convertFaceSymbol(str[0]);
-	suit = convertSuitSymbol(str[1]);
 }
 
 void Card::getValue(Face *f, Suit *s) const
 {
 	if (f)
-		*f = face;
+		*f = getFace();
 	
 	if (s)
-		*s = suit;
+		*s = getSuit();
 }
 
 char Card::getFaceSymbol() const
-{	
-	return face_symbols[face - Card::FirstFace];
+{
+	return face_symbols[code >> 2];
 }
 
 char Card::getSuitSymbol() const
 {
-	return suit_symbols[suit - Card::FirstSuit];
+	return suit_symbols[code & 3];
 }
 
 const char* Card::getName() const
 {
-	static char card_name[3];
-	
-	card_name[0] = getFaceSymbol();
-	card_name[1] = getSuitSymbol();
-	card_name[2] = '\0';
-	
-	return card_name;
+	return card_names.name[code];
 }
 
 Card::Face Card::convertFaceSymbol(char fsym)
 {
-	for (unsigned int i=Card::FirstFace; i <= Card::LastFace; i++)
-		if (fsym == face_symbols[i - Card::FirstFace])
-			return (Card::Face)i;
-		
-	return Card::FirstFace;
+	return (Card::Face)face_lookup.value[(unsigned char)fsym];
 }
 
 Card::Suit Card::convertSuitSymbol(char ssym)
 {
-	for (unsigned int i=Card::FirstSuit; i <= Card::LastSuit; i++)
-		if (ssym == suit_symbols[i - Card::FirstSuit])
-			return (Card::Suit)i;
-		
-	return Card::FirstSuit;
+	return (Card::Suit)suit_lookup.value[(unsigned char)ssym];
 }
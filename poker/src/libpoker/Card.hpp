@@ -24,6 +24,8 @@
 #ifndef _CARD_H
 #define _CARD_H
 
+/* A card is a single byte, (face-Two)*4 + (suit-FirstSuit), counting
+ * 0..51 over the full deck. */
 class Card
 {
 public:
@@ -56,16 +58,21 @@ public:
 		LastSuit=Spades
 	} Suit;
 	
-	Card();
-	Card(Face f, Suit s);
+	static const unsigned int Count = 52;
+	
+	Card() : code(encode(FirstFace, FirstSuit)) {};
+	Card(Face f, Suit s) : code(encode(f, s)) {};
 	Card(const char *str);
 	
 	void getValue(Face *f, Suit *s) const;
-	Face getFace() const { return face; };
-	Suit getSuit() const { return suit; };
+	Face getFace() const { return (Face)(Two + (code >> 2)); };
+	Suit getSuit() const { return (Suit)(FirstSuit + (code & 3)); };
+	unsigned int getCode() const { return code; };
 	
 	char getFaceSymbol() const;
 	char getSuitSymbol() const;
+	
+	// points into a constant table; valid forever and safe across threads
 	const char* getName() const;
 	
 	bool operator <  (const Card &c) const { return (getFace() < c.getFace()); };
@@ -74,10 +81,13 @@ public:
 	
 	static Face convertFaceSymbol(char fsym);
 	static Suit convertSuitSymbol(char ssym);
+	
+	static Card fromCode(unsigned int code) { Card c; c.code = (unsigned char)code; return c; };
 
 private:
-	Face face;
-	Suit suit;
+	static unsigned char encode(Face f, Suit s) { return (unsigned char)((f - Two) * 4 + (s - FirstSuit)); };
+	
+	unsigned char code;
 };
 
 
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include "CardSet.hpp"
+
+using namespace std;
+
+
+CardSet::CardSet(const vector<Card> &cards)
+{
+	mask = 0;
+	
+	for (vector<Card>::const_iterator e = cards.begin(); e != cards.end(); e++)
+		add(*e);
+}
+
+void CardSet::copyCards(vector<Card> *v) const
+{
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+		for (int f=Card::Two; f <= Card::LastFace; f++)
+		{
+			Card c((Card::Face)f, (Card::Suit)s);
+			if (contains(c))
+				v->push_back(c);
+		}
+}
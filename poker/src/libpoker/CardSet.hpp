@@ -0,0 +1,104 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _CARDSET_H
+#define _CARDSET_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "Card.hpp"
+
+/*
+	A set of cards stored as a 64-bit mask with one 16-bit lane per suit;
+	within a lane, bit n is set for the card of face n.
+*/
+
+class CardSet
+{
+public:
+	CardSet() : mask(0) {};
+	explicit CardSet(uint64_t m) : mask(m) {};
+	CardSet(const Card &c) : mask(bit(c)) {};
+	CardSet(const std::vector<Card> &cards);
+	
+	void add(const Card &c) { mask |= bit(c); };
+	void remove(const Card &c) { mask &= ~bit(c); };
+	void clear() { mask = 0; };
+	
+	bool contains(const Card &c) const { return (mask & bit(c)) != 0; };
+	bool contains(const CardSet &s) const { return (mask & s.mask) == s.mask; };
+	bool intersects(const CardSet &s) const { return (mask & s.mask) != 0; };
+	bool isEmpty() const { return !mask; };
+	unsigned int count() const { return popcount(mask); };
+	
+	uint64_t getMask() const { return mask; };
+	unsigned int getSuitMask(Card::Suit s) const { return (unsigned int)(mask >> (16 * (s - Card::FirstSuit))) & 0xffff; };
+	unsigned int getFaceMask() const { return (unsigned int)(mask | mask >> 16 | mask >> 32 | mask >> 48) & 0xffff; };
+	
+	void copyCards(std::vector<Card> *v) const;
+	
+	// the set with the lane of suit n moved to suit perm[n]
+	CardSet permuteSuits(const unsigned char perm[4]) const
+	{
+		uint64_t m = 0;
+		for (unsigned int s=0; s < 4; s++)
+			m |= ((mask >> (16 * s)) & 0xffff) << (16 * perm[s]);
+		return CardSet(m);
+	};
+	
+	CardSet operator | (const CardSet &s) const { return CardSet(mask | s.mask); };
+	CardSet operator & (const CardSet &s) const { return CardSet(mask & s.mask); };
+	CardSet operator - (const CardSet &s) const { return CardSet(mask & ~s.mask); };
+	CardSet& operator |= (const CardSet &s) { mask |= s.mask; return *this; };
+	CardSet& operator &= (const CardSet &s) { mask &= s.mask; return *this; };
+	CardSet& operator -= (const CardSet &s) { mask &= ~s.mask; return *this; };
+	bool operator == (const CardSet &s) const { return mask == s.mask; };
+	bool operator != (const CardSet &s) const { return mask != s.mask; };
+	
+	// the cards of the deck in play, Card::FirstFace to Card::LastFace of each suit
+	static CardSet deck()
+	{
+		const uint64_t lane = ((uint64_t)1 << (Card::LastFace + 1)) - ((uint64_t)1 << Card::FirstFace);
+		return CardSet(lane * 0x0001000100010001ULL);
+	};
+	
+	static uint64_t bit(const Card &c) { return (uint64_t)1 << (16 * (c.getSuit() - Card::FirstSuit) + c.getFace()); };
+	
+	static unsigned int popcount(uint64_t m)
+	{
+#if defined(__GNUC__)
+		return __builtin_popcountll(m);
+#else
+		m = m - ((m >> 1) & 0x5555555555555555ULL);
+		m = (m & 0x3333333333333333ULL) + ((m >> 2) & 0x3333333333333333ULL);
+		m = (m + (m >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return (unsigned int)((m * 0x0101010101010101ULL) >> 56);
+#endif
+	};
+	
+private:
+	uint64_t mask;
+};
+
+#endif /* _CARDSET_H */
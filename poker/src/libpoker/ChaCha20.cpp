@@ -0,0 +1,192 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#if defined(PLATFORM_WINDOWS)
+# include <random>
+#elif defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 25)
+# include <sys/random.h>
+# define HAVE_GETRANDOM
+#else
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include "ChaCha20.hpp"
+
+using namespace std;
+
+
+const unsigned int ChaCha20::RekeyBlocks;
+
+// needs no file descriptor, so a process out of them still gets entropy
+static bool read_entropy(uint32_t *buf, unsigned int words)
+{
+#if defined(PLATFORM_WINDOWS)
+	// backed by RtlGenRandom
+	random_device rd;
+	for (unsigned int i=0; i < words; i++)
+		buf[i] = rd();
+	return true;
+#else
+	char *p = (char*) buf;
+	size_t left = words * sizeof(uint32_t);
+	
+# if !defined(HAVE_GETRANDOM)
+	// opened once by the first generator and kept open
+	static const int fd = open("/dev/urandom", O_RDONLY);
+	if (fd == -1)
+		return false;
+# endif
+	
+	while (left)
+	{
+# if defined(HAVE_GETRANDOM)
+		const ssize_t n = getrandom(p, left, 0);
+# else
+		const ssize_t n = read(fd, p, left);
+# endif
+		if (n <= 0)
+		{
+			if (n == -1 && errno == EINTR)
+				continue;
+			return false;
+		}
+		
+		p += n;
+		left -= n;
+	}
+	
+	return true;
+#endif
+}
+
+static inline uint32_t rotl(uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d = rotl(d ^ a, 16); \
+	c += d; b = rotl(b ^ c, 12); \
+	a += b; d = rotl(d ^ a, 8); \
+	c += d; b = rotl(b ^ c, 7);
+
+
+ChaCha20::ChaCha20()
+	: reseed(true)
+{
+	uint32_t key[8] = {0};
+	setKey(key);
+	
+	// the zero key's keystream is public; never deal from it
+	if (!rekey())
+	{
+		fprintf(stderr, "ChaCha20: unable to read the OS entropy source\n");
+		abort();
+	}
+}
+
+ChaCha20::ChaCha20(const uint32_t key[8])
+	: reseed(false)
+{
+	setKey(key);
+}
+
+void ChaCha20::setKey(const uint32_t key[8])
+{
+	// "expand 32-byte k"
+	state[0] = 0x61707865;
+	state[1] = 0x3320646e;
+	state[2] = 0x79622d32;
+	state[3] = 0x6b206574;
+	
+	memcpy(state + 4, key, 8 * sizeof(uint32_t));
+	
+	// 64-bit block counter and nonce
+	state[12] = state[13] = 0;
+	state[14] = state[15] = 0;
+	
+	// unread keystream of the old key is never handed out
+	memset(block, 0, sizeof(block));
+	pos = 16;
+	blocks = 0;
+}
+
+bool ChaCha20::rekey()
+{
+	uint32_t key[8], fresh[8];
+	
+	// keep the old key's contribution if the OS source fails
+	for (unsigned int i=0; i < 8; i++)
+		key[i] = (*this)();
+	
+	const bool ok = read_entropy(fresh, 8);
+	if (ok)
+		for (unsigned int i=0; i < 8; i++)
+			key[i] ^= fresh[i];
+	
+	setKey(key);
+	memset(fresh, 0, sizeof(fresh));
+	memset(key, 0, sizeof(key));
+	
+	return ok;
+}
+
+void ChaCha20::refill()
+{
+	if (reseed && blocks >= RekeyBlocks)
+	{
+		blocks = 0;  // rekey() draws from the old key first
+		if (!rekey())
+			fprintf(stderr, "ChaCha20: rekey without fresh OS entropy\n");
+	}
+	
+	uint32_t x[16];
+	memcpy(x, state, sizeof(x));
+	
+	for (int i=0; i < 10; i++)
+	{
+		QUARTERROUND(x[0], x[4], x[8], x[12])
+		QUARTERROUND(x[1], x[5], x[9], x[13])
+		QUARTERROUND(x[2], x[6], x[10], x[14])
+		QUARTERROUND(x[3], x[7], x[11], x[15])
+		QUARTERROUND(x[0], x[5], x[10], x[15])
+		QUARTERROUND(x[1], x[6], x[11], x[12])
+		QUARTERROUND(x[2], x[7], x[8], x[13])
+		QUARTERROUND(x[3], x[4], x[9], x[14])
+	}
+	
+	for (int i=0; i < 16; i++)
+		block[i] = x[i] + state[i];
+	
+	if (++state[12] == 0)
+		state[13]++;
+	
+	pos = 0;
+	blocks++;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _CHACHA20_H
+#define _CHACHA20_H
+
+#include <stdint.h>
+
+/*
+	ChaCha20 keystream as a random bit generator for dealing cards.
+	
+	The key comes from the operating system's entropy source when the
+	generator is constructed; the process is aborted if there is none.
+	Every RekeyBlocks blocks the key is replaced by fresh keystream mixed
+	with new OS entropy, so a compromised state neither reveals earlier
+	deals nor predicts later ones for long.
+	
+	Not thread-safe; each table owns one.
+*/
+
+class ChaCha20
+{
+public:
+	typedef uint32_t result_type;
+	
+	static const unsigned int RekeyBlocks = 4096;  // 256 KiB of output
+	
+	ChaCha20();
+	
+	// fixed key with rekeying disabled; for tests against known vectors
+	explicit ChaCha20(const uint32_t key[8]);
+	
+	static constexpr result_type min() { return 0; };
+	static constexpr result_type max() { return 0xffffffff; };
+	
+	result_type operator()() {
+		if (pos == 16)
+			refill();
+		return block[pos++];
+	};
+	
+	// fetch new OS entropy now
+	bool rekey();
+	
+private:
+	void setKey(const uint32_t key[8]);
+	void refill();
+	
+	uint32_t state[16];
+	uint32_t block[16];
+	unsigned int pos;
+	unsigned int blocks;  // since the last rekey
+	bool reseed;
+};
+
+#endif /* _CHACHA20_H */
@@ -26,43 +26,45 @@
 
 using namespace std;
 
+const unsigned int CommunityCards::Capacity;
+
 CommunityCards::CommunityCards()
+	: count(0)
 {
 
 }
 
 bool CommunityCards::setFlop(Card c1, Card c2, Card c3)
 {
-	cards.clear();
-	
-	cards.push_back(c1);
-	cards.push_back(c2);
-	cards.push_back(c3);
+	cards[0] = c1;
+	cards[1] = c2;
+	cards[2] = c3;
+	count = 3;
 	
 	return true;
 }
 
 bool CommunityCards::setTurn(Card c)
 {
-	if (cards.size() != 3)
+	if (count != 3)
 		return false;
 	
-	cards.push_back(c);
+	cards[count++] = c;
 	
 	return true;
 }
 
 bool CommunityCards::setRiver(Card c)
 {
-	if (cards.size() != 4)
+	if (count != 4)
 		return false;
 	
-	cards.push_back(c);
+	cards[count++] = c;
 	
 	return true;
 }
 
 void CommunityCards::debug()
 {
-	print_cards("Community", &cards);
+	print_cards("Community", cards, count);
 }
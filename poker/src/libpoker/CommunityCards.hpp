@@ -27,10 +27,14 @@
 #include <vector>
 
 #include "Card.hpp"
+#include "CardSet.hpp"
 
+/* the cards are stored inline; begin()/end() read them without copying */
 class CommunityCards
 {
 public:
+	static const unsigned int Capacity = 5;
+	
 	CommunityCards();
 	
 	typedef enum {
@@ -44,13 +48,20 @@ public:
 	bool setTurn(Card c);
 	bool setRiver(Card c);
 	
-	void clear() { cards.clear(); };
+	void clear() { count = 0; };
+	
+	unsigned int size() const { return count; };
+	const Card* begin() const { return cards; };
+	const Card* end() const { return cards + count; };
+	const Card& operator[] (unsigned int i) const { return cards[i]; };
 	
-	void copyCards(std::vector<Card> *v) const { v->insert(v->end(), cards.begin(), cards.end()); };
+	void copyCards(std::vector<Card> *v) const { v->insert(v->end(), begin(), end()); };
+	void copyCards(CardSet *s) const { for (unsigned int i=0; i < count; i++) s->add(cards[i]); };
 	
 	void debug();
 private:
-	std::vector<Card> cards;
+	Card cards[Capacity];
+	unsigned char count;
 };
 
 #endif /* _COMMUNITYCARDS_H */
@@ -22,71 +22,104 @@
 
 
 #include <algorithm>
+#include <random>
 
 #include "GameDebug.hpp"
 #include "Deck.hpp"
-#include <random>
 
 using namespace std;
 
 
-void Deck::fill()
+const unsigned int Deck::Capacity;
+
+Deck::Deck(ChaCha20 &rng)
+	: size(0), unshuffled(0), rng(&rng)
 {
-	cards.clear();
-	
-	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
-		for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
-		{
-			Card c((Card::Face)f, (Card::Suit)s);
-			push(c);
-		}
 }
 
-void Deck::empty()
+void Deck::fill(Card::Face first)
 {
-	cards.clear();
+	size = 0;
+	unshuffled = 0;
+	
+	for (unsigned char code = Card(first, Card::FirstSuit).getCode(); size < Capacity && code < Capacity; code++)
+		cards[size++] = code;
 }
 
-int Deck::count() const
+void Deck::empty()
 {
-	return cards.size();
+	size = 0;
+	unshuffled = 0;
 }
 
 bool Deck::push(Card card)
 {
-	cards.push_back(card);
+	if (size == Capacity)
+		return false;
+	
+	cards[size++] = card.getCode();
 	return true;
 }
 
 bool Deck::pop(Card &card)
 {
-	if (!count())
+	if (!size)
 		return false;
 	
-	card = cards.back();
-	cards.pop_back();
+	/* the next Fisher-Yates step, as long as the top card belongs to the
+	 * shuffled part; cards pushed after shuffle() come off in stack order */
+	if (unshuffled == size)
+	{
+		uniform_int_distribution<unsigned int> pick(0, size - 1);
+		swap(cards[pick(*rng)], cards[size - 1]);
+		unshuffled--;
+	}
+	
+	card = Card::fromCode(cards[--size]);
 	return true;
 }
 
 bool Deck::shuffle()
 {
-    std::mt19937 r{std::random_device{}()};
-    std::shuffle(std::begin(cards), std::end(cards), r);
+	unshuffled = size;
+	return true;
+}
+
+bool Deck::load(const unsigned char *codes, unsigned int count)
+{
+	if (count > Capacity)
+		return false;
+	
+	copy(codes, codes + count, cards.begin());
+	size = count;
+	unshuffled = 0;
 	return true;
 }
 
 
 void Deck::debug()
 {
-	print_cards("Deck", &cards);
+	Card cv[Capacity];
+	for (unsigned int i=0; i < size; i++)
+		cv[i] = Card::fromCode(cards[i]);
+	
+	print_cards("Deck", cv, size);
 }
 
 void Deck::debugRemoveCard(Card card)
 {
-	for (vector<Card>::iterator e = cards.begin(); e != cards.end(); e++)
+	const unsigned char code = card.getCode();
+	
+	for (unsigned int i=0; i < size; i++)
 	{
-		if (e->getFace() == card.getFace() && e->getSuit() == card.getSuit()) {
-			cards.erase(e);
+		if (cards[i] == code)
+		{
+			for (unsigned int j=i + 1; j < size; j++)
+				cards[j - 1] = cards[j];
+			
+			size--;
+			if (i < unshuffled)
+				unshuffled--;
 			break;
 		}
 	}
@@ -24,27 +24,45 @@
 #ifndef _DECK_H
 #define _DECK_H
 
+#include <array>
 #include <vector>
 
 #include "Card.hpp"
+#include "ChaCha20.hpp"
 
+/* Cards are kept as their one byte codes in inline storage big enough
+ * for a full 52 card deck. shuffle() does not touch the cards; each pop()
+ * performs the next Fisher-Yates step instead, so a hand only pays for
+ * the cards actually dealt. The random engine belongs to the caller and
+ * must outlive the deck. */
 class Deck
 {
 public:
-	void fill();
+	static const unsigned int Capacity = Card::Count;
+	
+	explicit Deck(ChaCha20 &rng);
+	
+	// fill with the faces from 'first' to Ace; see Variant.hpp
+	void fill(Card::Face first=Card::FirstFace);
 	void empty();
-	int count() const;
+	int count() const { return (int)size; };
 	
 	bool push(Card card);
 	bool pop(Card &card);
 	bool shuffle();
 	
+	// replace the cards by an already shuffled sequence; the last is dealt first
+	bool load(const unsigned char *codes, unsigned int count);
+	
 	void debugRemoveCard(Card card);
 	void debugPushCards(const std::vector<Card> *cardsvec);
 	void debug();
 	
 private:
-	std::vector<Card> cards;
+	std::array<unsigned char, Capacity> cards;
+	unsigned int size;
+	unsigned int unshuffled;  // cards[0..unshuffled) are still to be drawn at random
+	ChaCha20 *rng;
 };
 
 #endif /* _DECK_H */
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <algorithm>
+#include <cstring>
+
+#include "EquityCache.hpp"
+
+using namespace std;
+
+
+bool EquityCache::Key::operator == (const Key &k) const
+{
+	return players == k.players && trials == k.trials && seed == k.seed &&
+		tolerance == k.tolerance && stratify == k.stratify &&
+		!memcmp(masks, k.masks, sizeof(masks));
+}
+
+size_t EquityCache::KeyHash::operator () (const Key &k) const
+{
+	uint64_t h = k.seed ^ ((uint64_t)k.trials << 32) ^ k.players;
+	
+	for (unsigned int i=0; i < k.players + 2; i++)
+	{
+		h ^= k.masks[i];
+		h *= 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	
+	return (size_t)h;
+}
+
+
+EquityCache::EquityCache(EquityEngine *engine, unsigned int capacity)
+	: engine(engine), hits(0), misses(0), evictions(0)
+{
+	shard_capacity = max(1u, capacity / Shards);
+}
+
+void EquityCache::makeKey(const EquityRequest &req, Key *key)
+{
+	memset(key, 0, sizeof(Key));
+	key->players = req.holes.size();
+	key->trials = req.trials;
+	key->seed = req.seed;
+	key->tolerance = req.tolerance;
+	key->stratify = req.stratify;
+	
+	// the smallest image of all card sets under the 24 suit permutations
+	unsigned char perm[4] = { 0, 1, 2, 3 };
+	bool first = true;
+	
+	do {
+		uint64_t m[EquityEngine::MaxPlayers + 2];
+		unsigned int n = 0;
+		
+		for (unsigned int p=0; p < key->players; p++)
+			m[n++] = req.holes[p].permuteSuits(perm).getMask();
+		m[n++] = req.board.permuteSuits(perm).getMask();
+		m[n++] = req.dead.permuteSuits(perm).getMask();
+		
+		if (first || lexicographical_compare(m, m + n, key->masks, key->masks + n))
+			memcpy(key->masks, m, n * sizeof(uint64_t));
+		
+		first = false;
+	} while (next_permutation(perm, perm + 4));
+}
+
+bool EquityCache::calculate(const EquityRequest &req, EquityResult *res)
+{
+	if (!req.ranges.empty() || req.holes.size() > EquityEngine::MaxPlayers)
+		return engine->calculate(req, res);
+	
+	Key key;
+	makeKey(req, &key);
+	
+	Shard &shard = shards[KeyHash()(key) % Shards];
+	
+	{
+		lock_guard<mutex> lock(shard.mutex);
+		
+		unordered_map<Key, lru_type::iterator, KeyHash>::iterator e = shard.index.find(key);
+		if (e != shard.index.end())
+		{
+			shard.lru.splice(shard.lru.begin(), shard.lru, e->second);
+			*res = e->second->second;
+			hits++;
+			return true;
+		}
+	}
+	
+	misses++;
+	
+	if (!engine->calculate(req, res))
+		return false;
+	
+	lock_guard<mutex> lock(shard.mutex);
+	
+	// computed by another thread meanwhile
+	if (shard.index.count(key))
+		return true;
+	
+	shard.lru.push_front(make_pair(key, *res));
+	shard.index[key] = shard.lru.begin();
+	
+	if (shard.lru.size() > shard_capacity)
+	{
+		shard.index.erase(shard.lru.back().first);
+		shard.lru.pop_back();
+		evictions++;
+	}
+	
+	return true;
+}
+
+void EquityCache::getStats(Stats *stats) const
+{
+	stats->hits = hits;
+	stats->misses = misses;
+	stats->evictions = evictions;
+	stats->entries = 0;
+	
+	for (unsigned int i=0; i < Shards; i++)
+	{
+		lock_guard<mutex> lock(shards[i].mutex);
+		stats->entries += shards[i].lru.size();
+	}
+}
+
+void EquityCache::clear()
+{
+	for (unsigned int i=0; i < Shards; i++)
+	{
+		lock_guard<mutex> lock(shards[i].mutex);
+		shards[i].lru.clear();
+		shards[i].index.clear();
+	}
+	
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _EQUITYCACHE_H
+#define _EQUITYCACHE_H
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "EquityEngine.hpp"
+
+/*
+	Least-recently-used cache of equity results in front of an
+	EquityEngine. Requests equal up to a permutation of suits share one
+	entry, e.g. AsKs vs QdQh on 7c8c9d and AhKh vs QsQd on 7c8c9s. The
+	trial count and seed are part of the key; range requests are passed
+	through uncached.
+	
+	The cache may be shared between threads. It is split into shards with
+	a lock each; a result is computed outside the lock, so two threads
+	missing on the same key at once both compute it.
+*/
+
+class EquityCache
+{
+public:
+	typedef struct {
+		unsigned long hits;
+		unsigned long misses;
+		unsigned long evictions;
+		unsigned long entries;
+	} Stats;
+	
+	EquityCache(EquityEngine *engine, unsigned int capacity = 65536);
+	
+	bool calculate(const EquityRequest &req, EquityResult *res);
+	
+	void getStats(Stats *stats) const;
+	void clear();
+	
+private:
+	typedef struct Key {
+		uint64_t masks[EquityEngine::MaxPlayers + 2];  // holes, board, dead
+		uint64_t seed;
+		double tolerance;
+		unsigned int players;
+		unsigned int trials;
+		bool stratify;
+		
+		bool operator == (const Key &k) const;
+	} Key;
+	
+	struct KeyHash {
+		size_t operator () (const Key &k) const;
+	};
+	
+	typedef std::list<std::pair<Key, EquityResult> > lru_type;
+	
+	typedef struct Shard {
+		mutable std::mutex mutex;
+		lru_type lru;  // most recently used first
+		std::unordered_map<Key, lru_type::iterator, KeyHash> index;
+	} Shard;
+	
+	static const unsigned int Shards = 16;
+	
+	static void makeKey(const EquityRequest &req, Key *key);
+	
+	EquityEngine *engine;
+	unsigned int shard_capacity;
+	Shard shards[Shards];
+	
+	std::atomic<unsigned long> hits;
+	std::atomic<unsigned long> misses;
+	std::atomic<unsigned long> evictions;
+};
+
+#endif /* _EQUITYCACHE_H */
@@ -0,0 +1,842 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "BoardContext.hpp"
+#include "EquityEngine.hpp"
+
+using namespace std;
+
+
+namespace {
+
+// trials are split into a fixed number of chunks, independent of the thread
+// count, to keep results reproducible
+const unsigned int MaxChunks = 64;
+
+// per-chunk sums, merged after all chunks are done
+typedef struct {
+	unsigned long trials;
+	unsigned long wins[EquityEngine::MaxPlayers];
+	unsigned long ties[EquityEngine::MaxPlayers];
+	double equity[EquityEngine::MaxPlayers];
+	double equity_sq[EquityEngine::MaxPlayers];
+	
+	// the same per stratum, i.e. per first card drawn, if stratified
+	unsigned long stratum_trials[36];
+	double stratum_equity[EquityEngine::MaxPlayers][36];
+	double stratum_equity_sq[EquityEngine::MaxPlayers][36];
+} Tally;
+
+// everything a chunk needs; shared read-only between chunks
+typedef struct {
+	unsigned int players;
+	Card known[EquityEngine::MaxPlayers][2];
+	unsigned int known_count[EquityEngine::MaxPlayers];
+	
+	BoardContext board;
+	unsigned int board_missing;
+	
+	Card stub[36];
+	unsigned int stub_count;
+	unsigned int draw_count;
+	
+	// the known cards, for finding suit symmetries
+	CardSet holes[EquityEngine::MaxPlayers];
+	CardSet board_cards;
+	CardSet dead;
+} Setup;
+
+// a distinct runout and the number of runouts it stands for
+typedef struct {
+	uint64_t mask;
+	unsigned int weight;
+} Runout;
+
+
+bool setup(const EquityRequest &req, Setup *s)
+{
+	const unsigned int players = req.holes.size();
+	
+	if (players < 2 || players > EquityEngine::MaxPlayers)
+		return false;
+	
+	if (req.board.count() > 5)
+		return false;
+	
+	// the evaluator only knows the cards of the deck
+	CardSet known = req.board | req.dead;
+	for (unsigned int p=0; p < players; p++)
+		known |= req.holes[p];
+	if (!CardSet::deck().contains(known))
+		return false;
+	
+	// all known cards must be distinct
+	CardSet used = req.board | req.dead;
+	if (req.board.intersects(req.dead))
+		return false;
+	
+	s->players = players;
+	s->draw_count = 5 - req.board.count();
+	s->board_missing = s->draw_count;
+	s->board_cards = req.board;
+	s->dead = req.dead;
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		const CardSet &h = req.holes[p];
+		
+		if (h.count() > 2 || h.intersects(used))
+			return false;
+		
+		used |= h;
+		s->holes[p] = h;
+		
+		vector<Card> cards;
+		h.copyCards(&cards);
+		
+		s->known_count[p] = cards.size();
+		for (unsigned int i=0; i < cards.size(); i++)
+			s->known[p][i] = cards[i];
+		
+		s->draw_count += 2 - cards.size();
+	}
+	
+	vector<Card> board;
+	req.board.copyCards(&board);
+	s->board.clear();
+	for (unsigned int i=0; i < board.size(); i++)
+		s->board.add(board[i]);
+	
+	s->stub_count = 0;
+	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		for (int su=Card::FirstSuit; su <= Card::LastSuit; su++)
+		{
+			Card c((Card::Face)f, (Card::Suit)su);
+			if (!used.contains(c))
+				s->stub[s->stub_count++] = c;
+		}
+	
+	return s->draw_count <= s->stub_count;
+}
+
+// hand keys of all players; returns the best key and sets how many players have it
+inline unsigned int settle(const BoardContext &board, const Card (*hole)[2], unsigned int players,
+	unsigned int *keys, unsigned int *best_count)
+{
+	unsigned int best = 0;
+	*best_count = 0;
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		keys[p] = board.evaluate(hole[p][0], hole[p][1]);
+		
+		if (keys[p] > best)
+		{
+			best = keys[p];
+			*best_count = 1;
+		}
+		else if (keys[p] == best)
+			(*best_count)++;
+	}
+	
+	return best;
+}
+
+// settle one runout on a complete board and count it weight times
+inline void showdown(const Setup &s, const BoardContext &board, const Card (*hole)[2],
+	unsigned int weight, int stratum, Tally *t)
+{
+	unsigned int keys[EquityEngine::MaxPlayers];
+	unsigned int best_count;
+	const unsigned int best = settle(board, hole, s.players, keys, &best_count);
+	
+	const double share = 1.0 / best_count;
+	
+	for (unsigned int p=0; p < s.players; p++)
+	{
+		if (keys[p] != best)
+			continue;
+		
+		if (best_count == 1)
+			t->wins[p] += weight;
+		else
+			t->ties[p] += weight;
+		
+		t->equity[p] += share * weight;
+		t->equity_sq[p] += share * share * weight;
+		
+		if (stratum != -1)
+		{
+			t->stratum_equity[p][stratum] += share * weight;
+			t->stratum_equity_sq[p][stratum] += share * share * weight;
+		}
+	}
+	
+	t->trials += weight;
+	
+	if (stratum != -1)
+		t->stratum_trials[stratum] += weight;
+}
+
+// uniform index in [0, n); the bias for n <= 36 is below 2^-26
+inline unsigned int random_index(mt19937_64 &rng, unsigned int n)
+{
+	return (unsigned int)(((rng() >> 32) * n) >> 32);
+}
+
+/*
+	Run the trials first..first+count-1. If stratified, the first card
+	drawn in trial n is not random but the stub card n modulo the stub
+	size, so every card comes first equally often.
+*/
+void sample_chunk(const Setup &s, unsigned long first, unsigned long count, bool stratified,
+	uint64_t seed, unsigned int chunk, Tally *t)
+{
+	seed_seq seq = { (uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)chunk };
+	mt19937_64 rng(seq);
+	
+	// stub as indices into s.stub, and where each index is
+	unsigned char stub[36], pos[36];
+	for (unsigned int i=0; i < s.stub_count; i++)
+		stub[i] = pos[i] = i;
+	
+	for (unsigned long n=0; n < count; n++)
+	{
+		int stratum = -1;
+		unsigned int i = 0;
+		
+		if (stratified && s.draw_count)
+		{
+			stratum = (first + n) % s.stub_count;
+			
+			const unsigned int j = pos[stratum];
+			swap(stub[0], stub[j]);
+			pos[stub[0]] = 0;
+			pos[stub[j]] = j;
+			i++;
+		}
+		
+		// partial Fisher-Yates; the stub stays a permutation between trials
+		for (; i < s.draw_count; i++)
+		{
+			const unsigned int j = i + random_index(rng, s.stub_count - i);
+			swap(stub[i], stub[j]);
+			pos[stub[i]] = i;
+			pos[stub[j]] = j;
+		}
+		
+		unsigned int drawn = 0;
+		
+		BoardContext board = s.board;
+		for (unsigned int i=0; i < s.board_missing; i++)
+			board.add(s.stub[stub[drawn++]]);
+		
+		Card hole[EquityEngine::MaxPlayers][2];
+		for (unsigned int p=0; p < s.players; p++)
+		{
+			hole[p][0] = s.known[p][0];
+			hole[p][1] = s.known[p][1];
+			for (unsigned int i = s.known_count[p]; i < 2; i++)
+				hole[p][i] = s.stub[stub[drawn++]];
+		}
+		
+		showdown(s, board, hole, 1, stratum, t);
+	}
+}
+
+void enumerate_chunk(const Setup &s, const Runout *runouts, unsigned int count, Tally *t)
+{
+	for (unsigned int n=0; n < count; n++)
+	{
+		BoardContext board = s.board;
+		
+		for (uint64_t m = runouts[n].mask; m; m &= m - 1)
+		{
+			const unsigned int bit = __builtin_ctzll(m);
+			board.add(Card((Card::Face)(bit & 15), (Card::Suit)(Card::FirstSuit + bit / 16)));
+		}
+		
+		showdown(s, board, s.known, runouts[n].weight, -1, t);
+	}
+}
+
+/*
+	Collect the runouts of the missing board cards, one of each class of
+	runouts that differ only by a swap of suits the known cards don't tell
+	apart. The weight of a runout is the size of its class.
+*/
+void collect_runouts(const Setup &s, vector<Runout> *runouts)
+{
+	// suit permutations mapping every known card set onto itself
+	vector<array<unsigned char, 4> > group;
+	array<unsigned char, 4> perm = {{ 0, 1, 2, 3 }};
+	do {
+		bool fixed = s.board_cards.permuteSuits(perm.data()) == s.board_cards &&
+			s.dead.permuteSuits(perm.data()) == s.dead;
+		
+		for (unsigned int p=0; fixed && p < s.players; p++)
+			fixed = s.holes[p].permuteSuits(perm.data()) == s.holes[p];
+		
+		if (fixed)
+			group.push_back(perm);
+	} while (next_permutation(perm.begin(), perm.end()));
+	
+	const unsigned int k = s.board_missing;
+	const unsigned int n = s.stub_count;
+	unsigned int idx[5] = { 0, 1, 2, 3, 4 };
+	
+	for (;;)
+	{
+		CardSet runout;
+		for (unsigned int i=0; i < k; i++)
+			runout.add(s.stub[idx[i]]);
+		
+		// keep the runout only if it is the smallest of its class
+		unsigned int stabilizer = 0;
+		bool smallest = true;
+		for (unsigned int g=0; g < group.size() && smallest; g++)
+		{
+			const uint64_t m = runout.permuteSuits(group[g].data()).getMask();
+			if (m < runout.getMask())
+				smallest = false;
+			else if (m == runout.getMask())
+				stabilizer++;
+		}
+		
+		if (smallest)
+		{
+			Runout r = { runout.getMask(), (unsigned int)group.size() / stabilizer };
+			runouts->push_back(r);
+		}
+		
+		// next k-combination of the stub indices
+		int i = (int)k - 1;
+		while (i >= 0 && idx[i] == n - k + i)
+			i--;
+		if (i < 0)
+			break;
+		
+		idx[i]++;
+		for (unsigned int j=i+1; j < k; j++)
+			idx[j] = idx[j - 1] + 1;
+	}
+}
+
+uint64_t get_seed(const EquityRequest &req)
+{
+	if (req.seed)
+		return req.seed;
+	
+	random_device rd;
+	return ((uint64_t)rd() << 32) | rd();
+}
+
+void merge(Tally *total, const Tally &t, unsigned int players, unsigned int strata)
+{
+	total->trials += t.trials;
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		total->wins[p] += t.wins[p];
+		total->ties[p] += t.ties[p];
+		total->equity[p] += t.equity[p];
+		total->equity_sq[p] += t.equity_sq[p];
+		
+		for (unsigned int h=0; h < strata; h++)
+		{
+			total->stratum_equity[p][h] += t.stratum_equity[p][h];
+			total->stratum_equity_sq[p][h] += t.stratum_equity_sq[p][h];
+		}
+	}
+	
+	for (unsigned int h=0; h < strata; h++)
+		total->stratum_trials[h] += t.stratum_trials[h];
+}
+
+// standard error of a player's mean equity; with equal-sized strata, only
+// the variance within the strata counts
+double standard_error(const Tally &t, unsigned int p, unsigned int strata)
+{
+	double variance = 0;
+	
+	for (unsigned int h=0; h < strata; h++)
+	{
+		const double n = t.stratum_trials[h];
+		if (n < 2)
+		{
+			// too few trials for all strata
+			strata = 0;
+			variance = 0;
+			break;
+		}
+		
+		const double m = t.stratum_equity[p][h] / n;
+		variance += max(0.0, t.stratum_equity_sq[p][h] / n - m * m) / n;
+	}
+	
+	if (strata)
+		return sqrt(variance) / strata;
+	
+	const double n = t.trials;
+	const double m = t.equity[p] / n;
+	variance = t.equity_sq[p] / n - m * m;
+	
+	return (variance > 0) ? sqrt(variance / n) : 0;
+}
+
+unsigned long binomial(unsigned int n, unsigned int k)
+{
+	unsigned long r = 1;
+	for (unsigned int i=1; i <= k; i++)
+		r = r * (n - k + i) / i;
+	return r;
+}
+
+
+/*
+	Ranges are sampled without rejecting whole trials: each player draws a
+	combo from those not blocked by the earlier players, and the trial
+	is weighted by the share of each range that was still available
+	(sequential importance sampling). Card removal by the board and dead
+	cards is applied once up front.
+*/
+
+typedef struct {
+	vector<Range::Combo> combos;
+	vector<double> cumulative;  // prefix sums of the combo weights
+	double total;
+	
+	// weight of the combos holding a card, and holding both of two cards
+	double card_weight[64];
+	vector<double> pair_weight;  // 64 x 64
+} RangeSetup;
+
+typedef struct {
+	unsigned int players;
+	RangeSetup ranges[EquityEngine::MaxPlayers];
+	
+	BoardContext board;
+	unsigned int board_missing;
+	CardSet used;  // board and dead cards
+} RangesSetup;
+
+// weighted sums of a chunk of range trials
+typedef struct {
+	unsigned long trials;
+	unsigned long evaluated;
+	double weight, weight_sq;
+	double wins[EquityEngine::MaxPlayers];
+	double ties[EquityEngine::MaxPlayers];
+	double equity[EquityEngine::MaxPlayers];     // sum of w * e
+	double equity_w2[EquityEngine::MaxPlayers];  // sum of w^2 * e
+	double equity_sq[EquityEngine::MaxPlayers];  // sum of w^2 * e^2
+} RangeTally;
+
+
+inline unsigned int bit_index(const Card &c)
+{
+	return __builtin_ctzll(CardSet::bit(c));
+}
+
+inline double random_unit(mt19937_64 &rng)
+{
+	return (rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool setup_ranges(const EquityRequest &req, RangesSetup *s)
+{
+	const unsigned int players = req.ranges.size();
+	
+	if (players < 2 || players > EquityEngine::MaxPlayers)
+		return false;
+	
+	if (req.board.count() > 5 || req.board.intersects(req.dead))
+		return false;
+	
+	if (!CardSet::deck().contains(req.board | req.dead))
+		return false;
+	
+	s->players = players;
+	s->used = req.board | req.dead;
+	s->board_missing = 5 - req.board.count();
+	
+	vector<Card> board;
+	req.board.copyCards(&board);
+	s->board.clear();
+	for (unsigned int i=0; i < board.size(); i++)
+		s->board.add(board[i]);
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		RangeSetup &r = s->ranges[p];
+		const vector<Range::Combo> &combos = req.ranges[p].getCombos();
+		
+		r.combos.clear();
+		r.cumulative.clear();
+		r.total = 0;
+		r.pair_weight.assign(64 * 64, 0);
+		memset(r.card_weight, 0, sizeof(r.card_weight));
+		
+		for (unsigned int i=0; i < combos.size(); i++)
+		{
+			const Range::Combo &c = combos[i];
+			if (!CardSet::deck().contains(c.cards))
+				return false;
+			
+			if (c.cards.intersects(s->used))
+				continue;
+			
+			const unsigned int b1 = bit_index(c.c1), b2 = bit_index(c.c2);
+			
+			r.combos.push_back(c);
+			r.total += c.weight;
+			r.cumulative.push_back(r.total);
+			r.card_weight[b1] += c.weight;
+			r.card_weight[b2] += c.weight;
+			r.pair_weight[b1 * 64 + b2] += c.weight;
+			r.pair_weight[b2 * 64 + b1] += c.weight;
+		}
+		
+		if (r.combos.empty())
+			return false;
+	}
+	
+	return true;
+}
+
+// weight of the combos in r not holding any of the taken cards
+inline double available_weight(const RangeSetup &r, const unsigned int *taken, unsigned int count)
+{
+	double w = r.total;
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		w -= r.card_weight[taken[i]];
+		for (unsigned int j=i+1; j < count; j++)
+			w += r.pair_weight[taken[i] * 64 + taken[j]];
+	}
+	
+	return w;
+}
+
+// draw a combo of r by weight among those not blocked; -1 if there is none
+int draw_combo(const RangeSetup &r, const CardSet &blocked, mt19937_64 &rng)
+{
+	// cheap retries keep the draw exact, as only blocked combos are redrawn
+	for (unsigned int attempt=0; attempt < 16; attempt++)
+	{
+		const double u = random_unit(rng) * r.total;
+		const unsigned int i = upper_bound(r.cumulative.begin(), r.cumulative.end(), u) - r.cumulative.begin();
+		
+		if (i < r.combos.size() && !r.combos[i].cards.intersects(blocked))
+			return i;
+	}
+	
+	// mostly blocked; pick among the available ones directly
+	double available = 0;
+	for (unsigned int i=0; i < r.combos.size(); i++)
+		if (!r.combos[i].cards.intersects(blocked))
+			available += r.combos[i].weight;
+	
+	double u = random_unit(rng) * available;
+	int last = -1;
+	for (unsigned int i=0; i < r.combos.size(); i++)
+	{
+		if (r.combos[i].cards.intersects(blocked))
+			continue;
+		
+		last = i;
+		u -= r.combos[i].weight;
+		if (u < 0)
+			break;
+	}
+	
+	return last;
+}
+
+void sample_ranges_chunk(const RangesSetup &s, unsigned long trials, uint64_t seed, unsigned int chunk, RangeTally *t)
+{
+	seed_seq seq = { (uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)chunk };
+	mt19937_64 rng(seq);
+	
+	for (unsigned long n=0; n < trials; n++)
+	{
+		t->trials++;
+		
+		Card hole[EquityEngine::MaxPlayers][2];
+		unsigned int taken[2 * EquityEngine::MaxPlayers];
+		CardSet blocked;
+		double weight = 1.0;
+		
+		for (unsigned int p=0; p < s.players && weight > 0; p++)
+		{
+			const RangeSetup &r = s.ranges[p];
+			
+			const double available = available_weight(r, taken, 2 * p);
+			const int i = (available > r.total * 1e-12) ? draw_combo(r, blocked, rng) : -1;
+			
+			if (i == -1)
+			{
+				weight = 0;
+				break;
+			}
+			
+			const Range::Combo &c = r.combos[i];
+			hole[p][0] = c.c1;
+			hole[p][1] = c.c2;
+			taken[2 * p] = bit_index(c.c1);
+			taken[2 * p + 1] = bit_index(c.c2);
+			blocked |= c.cards;
+			weight *= available / r.total;
+		}
+		
+		if (weight <= 0)
+			continue;
+		
+		// deal the rest of the board from the cards left
+		Card stub[36];
+		unsigned int stub_count = 0;
+		const CardSet out = s.used | blocked;
+		for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+			for (int su=Card::FirstSuit; su <= Card::LastSuit; su++)
+			{
+				Card c((Card::Face)f, (Card::Suit)su);
+				if (!out.contains(c))
+					stub[stub_count++] = c;
+			}
+		
+		BoardContext board = s.board;
+		for (unsigned int i=0; i < s.board_missing; i++)
+		{
+			swap(stub[i], stub[i + random_index(rng, stub_count - i)]);
+			board.add(stub[i]);
+		}
+		
+		unsigned int keys[EquityEngine::MaxPlayers];
+		unsigned int best_count;
+		const unsigned int best = settle(board, hole, s.players, keys, &best_count);
+		
+		const double share = 1.0 / best_count;
+		
+		t->evaluated++;
+		t->weight += weight;
+		t->weight_sq += weight * weight;
+		
+		for (unsigned int p=0; p < s.players; p++)
+		{
+			if (keys[p] != best)
+				continue;
+			
+			if (best_count == 1)
+				t->wins[p] += weight;
+			else
+				t->ties[p] += weight;
+			
+			t->equity[p] += weight * share;
+			t->equity_w2[p] += weight * weight * share;
+			t->equity_sq[p] += weight * weight * share * share;
+		}
+	}
+}
+
+}  // namespace
+
+
+EquityEngine::EquityEngine(unsigned int threads) : pool(threads)
+{
+	
+}
+
+bool EquityEngine::calculate(const EquityRequest &req, EquityResult *res)
+{
+	if (!req.ranges.empty())
+		return calculateRanges(req, res);
+	
+	Setup s;
+	
+	if (!req.trials || !setup(req, &s))
+		return false;
+	
+	const unsigned int players = s.players;
+	
+	// enumerate when all hole-cards are known and the runouts are no more than the trials
+	const bool exact = (s.draw_count == s.board_missing &&
+		binomial(s.stub_count, s.board_missing) <= req.trials);
+	
+	vector<Tally> tally;
+	Tally total = Tally();
+	unsigned int strata = 0;
+	
+	if (exact)
+	{
+		vector<Runout> runouts;
+		collect_runouts(s, &runouts);
+		
+		const unsigned int chunks = min<size_t>(runouts.size(), MaxChunks);
+		tally.assign(chunks, Tally());
+		
+		pool.run(chunks, [&](unsigned int c) {
+			const unsigned int first = runouts.size() * c / chunks;
+			const unsigned int last = runouts.size() * (c + 1) / chunks;
+			enumerate_chunk(s, &runouts[first], last - first, &tally[c]);
+		});
+		
+		for (unsigned int c=0; c < chunks; c++)
+			merge(&total, tally[c], players, 0);
+		
+		res->evaluated = runouts.size();
+	}
+	else
+	{
+		const uint64_t seed = get_seed(req);
+		strata = (req.stratify && s.draw_count) ? s.stub_count : 0;
+		
+		// with a tolerance, sample in rounds until the estimate is good enough
+		unsigned long next = (req.tolerance > 0) ? min<unsigned long>(req.trials, 4096) : req.trials;
+		
+		for (unsigned int round=0; next; round++)
+		{
+			const unsigned long done = total.trials;
+			const unsigned int chunks = min<unsigned long>(next, MaxChunks);
+			tally.assign(chunks, Tally());
+			
+			pool.run(chunks, [&](unsigned int c) {
+				const unsigned long first = done + next * c / chunks;
+				const unsigned long last = done + next * (c + 1) / chunks;
+				sample_chunk(s, first, last - first, strata != 0, seed, round * MaxChunks + c, &tally[c]);
+			});
+			
+			for (unsigned int c=0; c < chunks; c++)
+				merge(&total, tally[c], players, strata);
+			
+			if (req.tolerance <= 0 || total.trials >= req.trials)
+				break;
+			
+			// 95% confidence interval of the least certain player
+			double sd = 0;
+			for (unsigned int p=0; p < players; p++)
+				sd = max(sd, standard_error(total, p, strata) * sqrt((double)total.trials));
+			
+			const double needed = pow(1.96 * sd / req.tolerance, 2);
+			if (needed <= total.trials)
+				break;
+			
+			// aim a bit past the estimate, but at least grow by half
+			next = max<unsigned long>(needed * 1.1 - total.trials, total.trials / 2);
+			next = min(next, req.trials - total.trials);
+		}
+		
+		res->evaluated = total.trials;
+	}
+	
+	
+	const double n = total.trials;
+	
+	res->exact = exact;
+	res->trials = total.trials;
+	res->players.resize(players);
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		EquityResult::Player &r = res->players[p];
+		
+		r.win = total.wins[p] / n;
+		r.tie = total.ties[p] / n;
+		r.equity = total.equity[p] / n;
+		
+		r.stderror = exact ? 0 : standard_error(total, p, strata);
+	}
+	
+	return true;
+}
+
+bool EquityEngine::calculateRanges(const EquityRequest &req, EquityResult *res)
+{
+	RangesSetup s;
+	
+	if (!req.trials || !setup_ranges(req, &s))
+		return false;
+	
+	const unsigned int players = s.players;
+	const uint64_t seed = get_seed(req);
+	
+	const unsigned int chunks = min<unsigned long>(req.trials, MaxChunks);
+	vector<RangeTally> tally(chunks, RangeTally());
+	
+	pool.run(chunks, [&](unsigned int c) {
+		const unsigned long trials = req.trials / chunks + (c < req.trials % chunks);
+		sample_ranges_chunk(s, trials, seed, c, &tally[c]);
+	});
+	
+	
+	RangeTally total = RangeTally();
+	for (unsigned int c=0; c < chunks; c++)
+	{
+		total.trials += tally[c].trials;
+		total.evaluated += tally[c].evaluated;
+		total.weight += tally[c].weight;
+		total.weight_sq += tally[c].weight_sq;
+		
+		for (unsigned int p=0; p < players; p++)
+		{
+			total.wins[p] += tally[c].wins[p];
+			total.ties[p] += tally[c].ties[p];
+			total.equity[p] += tally[c].equity[p];
+			total.equity_w2[p] += tally[c].equity_w2[p];
+			total.equity_sq[p] += tally[c].equity_sq[p];
+		}
+	}
+	
+	// no combination of the ranges fits together
+	if (total.weight <= 0)
+		return false;
+	
+	const double w = total.weight;
+	
+	res->exact = false;
+	res->trials = total.trials;
+	res->evaluated = total.evaluated;
+	res->players.resize(players);
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		EquityResult::Player &r = res->players[p];
+		
+		r.win = total.wins[p] / w;
+		r.tie = total.ties[p] / w;
+		r.equity = total.equity[p] / w;
+		
+		// variance of the weighted mean: sum of w^2 (e - mean)^2 / (sum of w)^2
+		const double m = r.equity;
+		const double dev = total.equity_sq[p] - 2 * m * total.equity_w2[p] + m * m * total.weight_sq;
+		r.stderror = (dev > 0) ? sqrt(dev) / w : 0;
+	}
+	
+	return true;
+}
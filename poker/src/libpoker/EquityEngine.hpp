@@ -0,0 +1,108 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _EQUITYENGINE_H
+#define _EQUITYENGINE_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+#include "Range.hpp"
+#include "ThreadPool.hpp"
+
+/*
+	Monte Carlo equity of 2 to 10 players in a short-deck hand.
+	
+	Hole-cards of a player may be known, partly known or unknown; missing
+	hole-cards and board cards are dealt at random from the cards not
+	held, on the board or dead. Trials are split into chunks with their
+	own RNG stream each, so a fixed seed gives the same result on any
+	number of threads.
+	
+	Sampling deals the first missing card by turns instead of at random
+	(stratified sampling), which removes its share of the variance; it
+	may stop early once a requested tolerance is reached.
+	
+	When all hole-cards are known and there are no more board runouts
+	than trials, the runouts are enumerated instead; runouts differing
+	only by suits the known cards don't tell apart are evaluated once.
+	
+	Players may be given by weighted ranges instead; ranges are always
+	sampled.
+*/
+
+typedef struct EquityRequest {
+	EquityRequest() : trials(100000), seed(0), tolerance(0), stratify(true) {};
+	
+	std::vector<CardSet> holes;  // per player; 0 to 2 known cards
+	std::vector<Range> ranges;   // per player instead of holes, if given
+	CardSet board;               // 0 to 5 cards
+	CardSet dead;                // cards out of play
+	
+	unsigned int trials;         // also the limit for enumeration
+	uint64_t seed;               // 0: seed from std::random_device
+	
+	// stop sampling once the 95% confidence interval of every player's
+	// equity is within +-tolerance; trials is the maximum then
+	double tolerance;
+	
+	// deal every card first equally often
+	bool stratify;
+} EquityRequest;
+
+typedef struct EquityResult {
+	typedef struct {
+		double win;       // share of trials won alone
+		double tie;       // share of trials tied for the best hand
+		double equity;    // pot share; a tie of n players counts 1/n
+		double stderror;  // standard error of equity
+	} Player;
+	
+	std::vector<Player> players;
+	unsigned long trials;     // trials used, or runouts
+	unsigned long evaluated;  // trials or distinct runouts
+	bool exact;               // runouts were enumerated
+} EquityResult;
+
+
+class EquityEngine
+{
+public:
+	static const unsigned int MaxPlayers = 10;
+	
+	// 0 threads: one per hardware thread
+	explicit EquityEngine(unsigned int threads = 0);
+	
+	bool calculate(const EquityRequest &req, EquityResult *res);
+	
+	unsigned int getThreadCount() const { return pool.size(); };
+	
+private:
+	bool calculateRanges(const EquityRequest &req, EquityResult *res);
+	
+	ThreadPool pool;
+};
+
+#endif /* _EQUITYENGINE_H */
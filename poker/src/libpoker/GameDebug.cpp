@@ -28,10 +28,15 @@ using namespace std;
 #if DEBUG
 
 void print_cards(const char *name, vector<Card> *cards)
+{
+	print_cards(name, cards->data(), cards->size());
+}
+
+void print_cards(const char *name, const Card *cards, unsigned int count)
 {
 	fprintf(stderr, "[cards]: %s: [[ ", name);
-	for (vector<Card>::iterator e = cards->begin(); e != cards->end(); e++)
-		fprintf(stderr, "%s ", e->getName());
+	for (unsigned int i=0; i < count; i++)
+		fprintf(stderr, "%s ", cards[i].getName());
 	
 	fprintf(stderr, "]]\n");
 }
@@ -27,6 +27,7 @@
 #include "Debug.h"
 #include "GameDebug.hpp"
 #include "GameLogic.hpp"
+#include "HandEvaluator.hpp"
 
 using namespace std;
 
@@ -47,20 +48,91 @@ using namespace std;
 
 bool GameLogic::getStrength(const HoleCards *hole, const CommunityCards *community, HandStrength *strength)
 {
-	vector<Card> allcards;
+	CardSet allcards;
 	
 	// merge hole- and community-cards
 	hole->copyCards(&allcards);
 	community->copyCards(&allcards);
 	
-	return getStrength(&allcards, strength);
+	return getStrength(allcards, strength);
+}
+
+bool GameLogic::getStrength(const HoleCards *hole, const BoardContext *board, HandStrength *strength)
+{
+	// the board is pre-evaluated; only fold in the hole-cards
+	const unsigned int key = board->evaluate(hole);
+	
+	if (key)
+	{
+		strength->key = key;
+		return true;
+	}
+	
+	CardSet allcards = board->getCards();
+	hole->copyCards(&allcards);
+	
+	return getStrength(allcards, strength);
+}
+
+bool GameLogic::getStrength(const CardSet &allcards, HandStrength *strength)
+{
+	const unsigned int count = allcards.count();
+	
+	if (count >= 5 && count <= 7)
+	{
+		strength->key = HandEvaluator::evaluate(allcards);
+		return true;
+	}
+	
+	vector<Card> cards;
+	allcards.copyCards(&cards);
+	
+	return getStrengthByRules(&cards, strength);
 }
 
 bool GameLogic::getStrength(vector<Card> *allcards, HandStrength *strength)
 {
-	HandStrength::Ranking *r = &(strength->ranking);
-	vector<Card> *rank = &(strength->rank);
-	vector<Card> *kicker = &(strength->kicker);
+	// complete hands are looked up in the evaluator tables
+	if (allcards->size() >= 5 && allcards->size() <= 7)
+	{
+		strength->key = HandEvaluator::evaluate(*allcards);
+		return true;
+	}
+	
+	return getStrengthByRules(allcards, strength);
+}
+
+void GameLogic::evaluateBatch(const CommunityCards *community, const HoleCards *holes, unsigned int n, unsigned int *keys)
+{
+	CardSet board;
+	community->copyCards(&board);
+	
+	// convert the hole-cards chunk-wise to avoid allocating
+	const unsigned int chunk = 64;
+	CardSet hole[chunk];
+	
+	for (unsigned int i=0; i < n; i += chunk)
+	{
+		const unsigned int count = (n - i < chunk) ? n - i : chunk;
+		
+		for (unsigned int j=0; j < count; j++)
+		{
+			hole[j].clear();
+			holes[i + j].copyCards(&hole[j]);
+		}
+		
+		HandEvaluator::evaluateBatch(board, hole, count, keys + i);
+	}
+}
+
+bool GameLogic::getStrengthByRules(vector<Card> *allcards, HandStrength *strength)
+{
+	HandStrength::Ranking ranking;
+	vector<Card> rankcards, kickercards;
+	
+	HandStrength::Ranking *r = &ranking;
+	vector<Card> *rank = &rankcards;
+	vector<Card> *kicker = &kickercards;
 	
 	// sort them descending
 	sort(allcards->begin(), allcards->end(), greater<Card>());
@@ -108,6 +180,17 @@ bool GameLogic::getStrength(vector<Card> *allcards, HandStrength *strength)
 	print_cards("Kicker", kicker);
 #endif
 	
+	// pack rank- and kicker-faces into the strength key
+	Card::Face faces[5];
+	unsigned int count = 0;
+	
+	for (vector<Card>::iterator e = rank->begin(); e != rank->end() && count < 5; e++)
+		faces[count++] = e->getFace();
+	for (vector<Card>::iterator e = kicker->begin(); e != kicker->end() && count < 5; e++)
+		faces[count++] = e->getFace();
+	
+	strength->key = HandEvaluator::makeKey(*r, faces, count);
+	
 	return true;
 }
 
@@ -147,6 +230,7 @@ bool GameLogic::isTwoPair(std::vector<Card> *allcards, std::vector<Card> *rank,
 bool GameLogic::isStraight(vector<Card> *allcards, const int suit, vector<Card> *rank)
 {
 	bool is_straight = false;
+	bool has_ace = false;
 	int last_face = -1, count = 0;
 	Card high;
 	// allcards vector is passed in sorted in descending order
@@ -156,6 +240,9 @@ bool GameLogic::isStraight(vector<Card> *allcards, const int suit, vector<Card>
 		if (suit != -1 && e->getSuit() != suit)
 			continue;
 		
+		if (e->getFace() == Card::Ace)
+			has_ace = true;
+		
 		// ignore cards of same face (e.g. Qs and Qc)
 		if (last_face == e->getFace())
 			continue;
@@ -178,11 +265,11 @@ bool GameLogic::isStraight(vector<Card> *allcards, const int suit, vector<Card>
 	}
 	
 	// is an A2345-straight ("wheel")
-	if (count == 4 && (last_face == Card::Two && allcards->front().getFace() == Card::Ace))
+	if (count == 4 && (last_face == Card::Two && has_ace))
 		is_straight = true;
     
     // is A6789-straight (in 6 plus holdem the Ace "wraps around" and acts like a five)
-    if (count == 4 && (last_face == Card::Six && allcards->front().getFace() == Card::Ace))
+    if (count == 4 && (last_face == Card::Six && has_ace))
         is_straight = true;
 	
 	if (is_straight)
@@ -224,6 +311,48 @@ bool GameLogic::isFlush(vector<Card> *allcards, vector<Card> *rank)
 	return is_flush;
 }
 
+bool GameLogic::isStraight(const CardSet &allcards, const int suit, Card::Face *high)
+{
+	const unsigned int faces = (suit == -1) ? allcards.getFaceMask() : allcards.getSuitMask((Card::Suit)suit);
+	
+	// a bit remains set for each face starting a run of five
+	const unsigned int runs = faces & (faces >> 1) & (faces >> 2) & (faces >> 3) & (faces >> 4);
+	
+	if (runs)
+	{
+		for (int f=Card::LastFace - 4; f >= Card::FirstFace; f--)
+			if (runs & (1 << f))
+			{
+				*high = (Card::Face)(f + 4);
+				return true;
+			}
+	}
+	
+	// the Ace acts as the lowest card
+	const unsigned int wrap = (1 << Card::Ace) | (0xf << Card::FirstFace);
+	if ((faces & wrap) == wrap)
+	{
+		*high = (Card::Face)(Card::FirstFace + 3);
+		return true;
+	}
+	
+	return false;
+}
+
+bool GameLogic::isFlush(const CardSet &allcards, Card::Suit *suit)
+{
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+	{
+		if (CardSet::popcount(allcards.getSuitMask((Card::Suit)s)) >= 5)
+		{
+			*suit = (Card::Suit)s;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
 bool GameLogic::isXOfAKind(vector<Card> *allcards, const unsigned int n, vector<Card> *rank, vector<Card> *kicker)
 {
 	bool is_xofakind = false;
@@ -300,35 +429,52 @@ bool GameLogic::isFullHouse(vector<Card> *allcards, vector<Card> *rank)
 	return is_fullhouse;
 }
 
+bool GameLogic::getWinList(const HandStrength *hands, unsigned int count, WinList *winlist)
+{
+	if (count > WinList::MaxHands)
+		return false;
+	
+	// insertion sort by key, strongest first; stable for equal keys
+	for (unsigned int i=0; i < count; i++)
+	{
+		unsigned int j = i;
+		for (; j > 0 && winlist->hands[j - 1] < hands[i]; j--)
+			winlist->hands[j] = winlist->hands[j - 1];
+		
+		winlist->hands[j] = hands[i];
+	}
+	
+	// one pass over the sorted keys for the group boundaries
+	winlist->count = count;
+	winlist->groups = 0;
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		if (!i || winlist->hands[i] < winlist->hands[i - 1])
+			winlist->group_start[winlist->groups++] = i;
+	}
+	
+	winlist->group_start[winlist->groups] = count;
+	
+	return true;
+}
+
 bool GameLogic::getWinList(vector<HandStrength> &hands, vector< vector<HandStrength> > &winlist)
 {
+	WinList wl;
+	
+	if (!getWinList(hands.data(), hands.size(), &wl))
+		return false;
+	
 	winlist.clear();
-	winlist.push_back(hands);
 	
-	unsigned int index=0;
-	do
+	for (unsigned int g=0; g < wl.getGroupCount(); g++)
 	{
-		vector<HandStrength> &tw = winlist[index];
-		vector<HandStrength> tmp;
-		
-		sort(tw.begin(), tw.end(), greater<HandStrength>());
-		
-		for (unsigned int i=tw.size()-1; i > 0; i--)
-		{
-			if (tw[i] < tw[0])
-			{
-				tmp.push_back(tw[i]);
-				tw.pop_back();
-			}
-		}
-		
-		if (!tmp.size())
-			break;
+		winlist.push_back(vector<HandStrength>());
 		
-		winlist.push_back(tmp);
-		index++;
-		
-	} while (true);
+		for (unsigned int i=0; i < wl.getGroupSize(g); i++)
+			winlist.back().push_back(wl.get(g, i));
+	}
 	
 	return true;
 }
@@ -350,74 +496,20 @@ const char* HandStrength::getRankingName(Ranking r)
 	return sstr[r - HighCard];
 }
 
-bool HandStrength::operator < (const HandStrength &c) const
+void HandStrength::copyRankCards(vector<Card> *v) const
 {
-	if (getRanking() < c.getRanking())
-		return true;
-	else if (getRanking() > c.getRanking())
-		return false;
+	const unsigned int count = HandEvaluator::getRankCount(getRanking());
 	
-	for (unsigned int i=0; i < rank.size(); i++)
-	{
-		if (rank[i].getFace() < c.rank[i].getFace())
-			return true;
-		else if (rank[i].getFace() > c.rank[i].getFace())
-			return false;
-	}
-	
-	for (unsigned int i=0; i < kicker.size(); i++)
-	{
-		if (kicker[i].getFace() < c.kicker[i].getFace())
-			return true;
-		else if (kicker[i].getFace() > c.kicker[i].getFace())
-			return false;
-	}
-	
-	return false;
-}
-
-bool HandStrength::operator > (const HandStrength &c) const
-{
-	if (getRanking() > c.getRanking())
-		return true;
-	else if (getRanking() < c.getRanking())
-		return false;
-	
-	for (unsigned int i=0; i < rank.size(); i++)
-	{
-		if (rank[i].getFace() > c.rank[i].getFace())
-			return true;
-		else if (rank[i].getFace() < c.rank[i].getFace())
-			return false;
-	}
-	
-	for (unsigned int i=0; i < kicker.size(); i++)
-	{
-		if (kicker[i].getFace() > c.kicker[i].getFace())
-			return true;
-		else if (kicker[i].getFace() < c.kicker[i].getFace())
-			return false;
-	}
-	
-	return false;
+	for (unsigned int i=0; i < count; i++)
+		v->push_back(Card(HandEvaluator::getFace(key, i), Card::FirstSuit));
 }
 
-bool HandStrength::operator == (const HandStrength &c) const
+void HandStrength::copyKickerCards(vector<Card> *v) const
 {
-	if (getRanking() != c.getRanking())
-		return false;
-	
-	for (unsigned int i=0; i < rank.size(); i++)
-	{
-		if (rank[i].getFace() != c.rank[i].getFace())
-			return false;
-	}
+	const unsigned int first = HandEvaluator::getRankCount(getRanking());
+	const unsigned int count = HandEvaluator::getKickerCount(getRanking());
 	
-	for (unsigned int i=0; i < kicker.size(); i++)
-	{
-		if (kicker[i].getFace() != c.kicker[i].getFace())
-			return false;
-	}
-	
-	return true;
+	// kickers may be missing for hands of less than 5 cards
+	for (unsigned int i=first; i < first + count && HandEvaluator::getFace(key, i); i++)
+		v->push_back(Card(HandEvaluator::getFace(key, i), Card::FirstSuit));
 }
@@ -27,8 +27,10 @@
 #include <vector>
 
 #include "Card.hpp"
+#include "CardSet.hpp"
 #include "HoleCards.hpp"
 #include "CommunityCards.hpp"
+#include "BoardContext.hpp"
 
 class HandStrength
 {
@@ -47,27 +49,53 @@ public:
 		StraightFlush
 	} Ranking;
 	
-	Ranking getRanking() const { return ranking; };
+	Ranking getRanking() const { return (Ranking)((key >> 20) & 0xf); };
 	static const char* getRankingName(Ranking r);
 	
-	void copyRankCards(std::vector<Card> *v) const { v->insert(v->end(), rank.begin(), rank.end()); };
-	void copyKickerCards(std::vector<Card> *v) const { v->insert(v->end(), kicker.begin(), kicker.end()); };
+	// the packed strength key; see HandEvaluator.hpp for the layout
+	unsigned int getKey() const { return key; };
+	
+	// decoded cards carry the face only; suits are not part of the strength
+	void copyRankCards(std::vector<Card> *v) const;
+	void copyKickerCards(std::vector<Card> *v) const;
 	
 	void setId(int rid) { id = rid; };
 	int getId() const { return id; };
 	
-	bool operator < (const HandStrength &c) const;
-	bool operator > (const HandStrength &c) const;
-	bool operator == (const HandStrength &c) const;
+	bool operator < (const HandStrength &c) const { return (key < c.key); };
+	bool operator > (const HandStrength &c) const { return (key > c.key); };
+	bool operator == (const HandStrength &c) const { return (key == c.key); };
 	
 private:
-	Ranking ranking;
-	std::vector<Card> rank;
-	std::vector<Card> kicker;
+	unsigned int key;
 	
 	int id;  // identifier; can be used for associating player
 };
 
+/*
+	Hands grouped by strength, strongest group first; hands of equal
+	strength keep their input order. Fixed capacity, no heap allocation.
+*/
+class WinList
+{
+friend class GameLogic;
+
+public:
+	static const unsigned int MaxHands = 10;
+	
+	WinList() : count(0), groups(0) {};
+	
+	unsigned int getGroupCount() const { return groups; };
+	unsigned int getGroupSize(unsigned int g) const { return group_start[g + 1] - group_start[g]; };
+	const HandStrength& get(unsigned int g, unsigned int i) const { return hands[group_start[g] + i]; };
+	
+private:
+	HandStrength hands[MaxHands];
+	unsigned char group_start[MaxHands + 1];
+	unsigned int count;
+	unsigned int groups;
+};
+
 class GameLogic
 {
 public:
@@ -75,6 +103,12 @@ public:
 	
 	static bool getStrength(std::vector<Card> *allcards, HandStrength *strength);
 	static bool getStrength(const HoleCards *hole, const CommunityCards *community, HandStrength *strength);
+	static bool getStrength(const CardSet &allcards, HandStrength *strength);
+	static bool getStrength(const HoleCards *hole, const BoardContext *board, HandStrength *strength);
+	static bool getStrengthByRules(std::vector<Card> *allcards, HandStrength *strength);
+	
+	// strength keys of many hole-cards against the same board
+	static void evaluateBatch(const CommunityCards *community, const HoleCards *holes, unsigned int n, unsigned int *keys);
 	
 	static bool isTwoPair(std::vector<Card> *allcards, std::vector<Card> *rank, std::vector<Card> *kicker);
 	static bool isStraight(std::vector<Card> *allcards, const int suit, std::vector<Card> *rank);
@@ -82,6 +116,10 @@ public:
 	static bool isXOfAKind(std::vector<Card> *allcards, const unsigned int n, std::vector<Card> *rank, std::vector<Card> *kicker);
 	static bool isFullHouse(std::vector<Card> *allcards, std::vector<Card> *rank);
 	
+	static bool isStraight(const CardSet &allcards, const int suit, Card::Face *high);
+	static bool isFlush(const CardSet &allcards, Card::Suit *suit);
+	
+	static bool getWinList(const HandStrength *hands, unsigned int count, WinList *winlist);
 	static bool getWinList(std::vector<HandStrength> &hands, std::vector< std::vector<HandStrength> > &winlist);
 };
 
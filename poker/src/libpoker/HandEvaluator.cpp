@@ -0,0 +1,323 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstddef>
+#include <vector>
+
+#include "GameLogic.hpp"
+#include "HandEvaluator.hpp"
+#include "HandEvaluatorTables.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define HAVE_AVX2_KERNEL
+# include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+// count of rank- and kicker-cards, indexed by HandStrength::Ranking
+static const unsigned int rank_count[] = { 1, 1, 2, 1, 1, 2, 5, 1, 1 };
+static const unsigned int kicker_count[] = { 4, 3, 1, 2, 0, 0, 0, 1, 0 };
+
+template <class V>
+static constexpr MaskTables<V> mask_tables = make_mask_tables<V>();
+
+
+template <class V>
+struct BasicHandEvaluator<V>::Tables
+{
+	const unsigned int *flush;
+	const unsigned int *mask_hash;
+	const unsigned int *face_hash;
+	
+	// non-flush keys, indexed by displace[row_base[count-5] + (hash >> RowShift)] + (hash & RowMask)
+	const unsigned int *noflush;
+	const unsigned int *displace;
+	unsigned int row_base[3];
+	
+	unsigned int noFlushIndex(unsigned int count, unsigned int hash) const
+	{
+		return displace[row_base[count - 5] + (hash >> RowShift)] + (hash & RowMask);
+	}
+};
+
+#ifdef HANDEVAL_STATIC_TABLES
+
+template <class V>
+const typename BasicHandEvaluator<V>::Tables& BasicHandEvaluator<V>::tables()
+{
+	// all tables are read-only data; constant-initialized, no init step
+	static constexpr Tables t = {
+		mask_tables<V>.flush, mask_tables<V>.mask_hash, mask_tables<V>.face_hash,
+		NoFlushData<V>::keys, NoFlushData<V>::displace,
+		{ row_base<V>(5), row_base<V>(6), row_base<V>(7) }
+	};
+	return t;
+}
+
+#else
+
+// the non-flush tables are built on first use
+template <class V>
+struct NoFlushStorage
+{
+	NoFlushStorage() { build_noflush<V>(&keys, &displace); };
+	
+	vector<unsigned int> keys;
+	vector<unsigned int> displace;
+};
+
+template <class V>
+const typename BasicHandEvaluator<V>::Tables& BasicHandEvaluator<V>::tables()
+{
+	static const NoFlushStorage<V> data;
+	static const Tables t = {
+		mask_tables<V>.flush, mask_tables<V>.mask_hash, mask_tables<V>.face_hash,
+		&data.keys[0], &data.displace[0],
+		{ row_base<V>(5), row_base<V>(6), row_base<V>(7) }
+	};
+	return t;
+}
+
+#endif /* HANDEVAL_STATIC_TABLES */
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::getRankCount(unsigned int ranking)
+{
+	return rank_count[ranking];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::getKickerCount(unsigned int ranking)
+{
+	return kicker_count[ranking];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::getFaceHash(Card::Face f)
+{
+	return tables().face_hash[f - V::FirstFace];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::lookupFlush(unsigned int mask)
+{
+	return tables().flush[mask];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::lookupNoFlush(unsigned int count, unsigned int hash)
+{
+	const Tables &t = tables();
+	return t.noflush[t.noFlushIndex(count, hash)];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::evaluate(const Card *cards, unsigned int count)
+{
+	const Tables &t = tables();
+	
+	unsigned int hash = 0;
+	unsigned int suits = 0;  // one nibble per suit
+	unsigned int suit_mask[4] = { 0, 0, 0, 0 };
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		const unsigned int f = cards[i].getFace() - V::FirstFace;
+		const unsigned int s = cards[i].getSuit() - Card::FirstSuit;
+		
+		hash += t.face_hash[f];
+		suits += 1 << (4*s);
+		suit_mask[s] |= 1 << f;
+	}
+	
+	// a nibble with 5 or more cards overflows into its high bit
+	const unsigned int flush = (suits + 0x3333) & 0x8888;
+	if (flush)
+	{
+		for (unsigned int s=0; s < 4; s++)
+			if (flush & (0x8 << (4*s)))
+				return t.flush[suit_mask[s]];
+	}
+	
+	return t.noflush[t.noFlushIndex(count, hash)];
+}
+
+template <class V>
+unsigned int BasicHandEvaluator<V>::evaluate(const CardSet &cards)
+{
+	const Tables &t = tables();
+	
+	unsigned int hash = 0;
+	
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+	{
+		const unsigned int m = (cards.getSuitMask((Card::Suit)s) >> V::FirstFace) & ((1 << Faces) - 1);
+		
+		if (CardSet::popcount(m) >= 5)
+			return t.flush[m];
+		
+		hash += t.mask_hash[m];
+	}
+	
+	return t.noflush[t.noFlushIndex(cards.count(), hash)];
+}
+
+template <class V>
+bool BasicHandEvaluator<V>::hasSIMD()
+{
+#ifdef HAVE_AVX2_KERNEL
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+#else
+	return false;
+#endif
+}
+
+template <class V>
+void BasicHandEvaluator<V>::evaluateBatch(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys)
+{
+	if (hasSIMD())
+		evaluateBatchAVX2(board, holes, n, keys);
+	else
+		evaluateBatchScalar(board, holes, n, keys);
+}
+
+template <class V>
+void BasicHandEvaluator<V>::evaluateBatchScalar(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys)
+{
+	for (unsigned int i=0; i < n; i++)
+		keys[i] = evaluate(board | holes[i]);
+}
+
+#ifdef HAVE_AVX2_KERNEL
+
+/*
+	Evaluates 8 hands per iteration, one hand per 32-bit lane. For each
+	suit the lane holds the face mask of board and hole cards; its popcount
+	detects the flush and its mask-hash adds up to the non-flush hash,
+	exactly like the scalar evaluate(CardSet).
+*/
+static_assert(sizeof(CardSet) == sizeof(uint64_t), "CardSet arrays are loaded as masks");
+
+// returns the number of hands evaluated, a multiple of 8
+__attribute__((target("avx2")))
+static unsigned int batch_avx2(const unsigned int *flush_table, const unsigned int *mask_hash,
+	const unsigned int *noflush, const unsigned int *displace, const unsigned int *row_bases,
+	unsigned int first_face, unsigned int faces,
+	const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys)
+{
+	const __m256i face_mask = _mm256_set1_epi64x((1 << faces) - 1);
+	const __m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i popcount_lut = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i row_base = _mm256_setr_epi32(row_bases[0], row_bases[1], row_bases[2], 0, 0, 0, 0, 0);
+	const __m256i row_mask = _mm256_set1_epi32(RowMask);
+	const __m256i four = _mm256_set1_epi32(4);
+	const __m256i five = _mm256_set1_epi32(5);
+	const __m256i byte = _mm256_set1_epi32(0xff);
+	
+	__m256i board_lane[4];
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+		board_lane[s - Card::FirstSuit] = _mm256_set1_epi32((board.getSuitMask((Card::Suit)s) >> first_face) & ((1 << faces) - 1));
+	
+	unsigned int i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m256i lo = _mm256_loadu_si256((const __m256i*)(holes + i));
+		const __m256i hi = _mm256_loadu_si256((const __m256i*)(holes + i + 4));
+		
+		__m256i hash = _mm256_setzero_si256();
+		__m256i count = _mm256_setzero_si256();
+		__m256i is_flush = _mm256_setzero_si256();
+		__m256i flush_key = _mm256_setzero_si256();
+		
+		for (unsigned int s=0; s < 4; s++)
+		{
+			const __m128i shift = _mm_cvtsi32_si128(16 * s + first_face);
+			
+			// narrow the suit lane of each 64-bit mask to 32 bits
+			__m256i a = _mm256_and_si256(_mm256_srl_epi64(lo, shift), face_mask);
+			__m256i b = _mm256_and_si256(_mm256_srl_epi64(hi, shift), face_mask);
+			a = _mm256_permutevar8x32_epi32(a, pack);
+			b = _mm256_permutevar8x32_epi32(b, pack);
+			
+			const __m256i m = _mm256_or_si256(_mm256_permute2x128_si256(a, b, 0x20), board_lane[s]);
+			
+			// popcount of the face mask, which spans two bytes
+			__m256i pc = _mm256_add_epi8(
+				_mm256_shuffle_epi8(popcount_lut, _mm256_and_si256(m, nibble)),
+				_mm256_shuffle_epi8(popcount_lut, _mm256_and_si256(_mm256_srli_epi32(m, 4), nibble)));
+			pc = _mm256_and_si256(_mm256_add_epi32(pc, _mm256_srli_epi32(pc, 8)), byte);
+			
+			const __m256i flush = _mm256_cmpgt_epi32(pc, four);
+			flush_key = _mm256_mask_i32gather_epi32(flush_key, (const int*)flush_table, m, flush, 4);
+			is_flush = _mm256_or_si256(is_flush, flush);
+			
+			hash = _mm256_add_epi32(hash, _mm256_i32gather_epi32((const int*)mask_hash, m, 4));
+			count = _mm256_add_epi32(count, pc);
+		}
+		
+		const __m256i row = _mm256_add_epi32(_mm256_srli_epi32(hash, RowShift),
+			_mm256_permutevar8x32_epi32(row_base, _mm256_sub_epi32(count, five)));
+		const __m256i index = _mm256_add_epi32(_mm256_and_si256(hash, row_mask),
+			_mm256_i32gather_epi32((const int*)displace, row, 4));
+		
+		// look up the non-flush lanes only
+		const __m256i key = _mm256_mask_i32gather_epi32(flush_key, (const int*)noflush, index,
+			_mm256_andnot_si256(is_flush, _mm256_set1_epi32(-1)), 4);
+		
+		_mm256_storeu_si256((__m256i*)(keys + i), key);
+	}
+	
+	return i;
+}
+
+template <class V>
+void BasicHandEvaluator<V>::evaluateBatchAVX2(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys)
+{
+	const Tables &t = tables();
+	
+	const unsigned int i = batch_avx2(t.flush, t.mask_hash, t.noflush, t.displace, t.row_base,
+		V::FirstFace, Faces, board, holes, n, keys);
+	
+	evaluateBatchScalar(board, holes + i, n - i, keys + i);
+}
+
+#else
+
+template <class V>
+void BasicHandEvaluator<V>::evaluateBatchAVX2(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys)
+{
+	evaluateBatchScalar(board, holes, n, keys);
+}
+
+#endif /* HAVE_AVX2_KERNEL */
+
+
+// the evaluators of all variants
+template class BasicHandEvaluator<ShortDeck>;
+template class BasicHandEvaluator<FullDeck>;
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _HANDEVALUATOR_H
+#define _HANDEVALUATOR_H
+
+#include <vector>
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+#include "Variant.hpp"
+
+/*
+	Table-driven evaluation of 5 to 7 cards, specialized at compile-time
+	for a variant policy (see Variant.hpp).
+	
+	The result is a strength key which orders hands exactly like the
+	HandStrength comparison operators:
+	
+	  bits 24-27   category order of the variant
+	  bits 20-23   ranking (HandStrength::Ranking)
+	  bits 16-19   1st rank card face
+	  bits 12-15   2nd rank/kicker card face
+	  ...
+	  bits  0- 3   5th rank/kicker card face
+	
+	Rank faces come first, followed by the kicker faces; unused nibbles
+	are zero. Only 5 to 7 cards may be passed to evaluate().
+	
+	Flushes are looked up by the face mask of the flush suit. All other
+	hands are looked up by the sum of per-face hash values; the values are
+	chosen so that no two face multisets of the same size share a sum.
+	The sparse sums are compressed by row displacement: the sum's high
+	bits select a row offset into the dense key table.
+*/
+
+template <class Variant>
+class BasicHandEvaluator
+{
+public:
+	static const unsigned int Faces = Variant::Faces;
+	
+	static unsigned int evaluate(const Card *cards, unsigned int count);
+	static unsigned int evaluate(const std::vector<Card> &cards) { return evaluate(cards.data(), cards.size()); };
+	static unsigned int evaluate(const CardSet &cards);
+	
+	// evaluate board|holes[i] for n hands; holes must not intersect the board
+	static void evaluateBatch(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys);
+	static bool hasSIMD();
+	
+	static unsigned int getRanking(unsigned int key) { return (key >> 20) & 0xf; };
+	static Card::Face getFace(unsigned int key, unsigned int i) { return (Card::Face)((key >> (16 - 4*i)) & 0xf); };
+	static unsigned int getRankCount(unsigned int ranking);
+	static unsigned int getKickerCount(unsigned int ranking);
+	
+	static constexpr unsigned int makeKey(unsigned int ranking, const Card::Face *faces, unsigned int count)
+	{
+		unsigned int key = Variant::order(ranking) << 24 | ranking << 20;
+		for (unsigned int i=0; i < count; i++)
+			key |= (unsigned int)faces[i] << (16 - 4*i);
+		return key;
+	};
+	
+	// building blocks for incremental evaluation (see BoardContext)
+	static unsigned int getFaceHash(Card::Face f);
+	static unsigned int lookupFlush(unsigned int mask);
+	static unsigned int lookupNoFlush(unsigned int count, unsigned int hash);
+	
+private:
+	struct Tables;
+	static const Tables& tables();
+	
+	static void evaluateBatchScalar(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys);
+	static void evaluateBatchAVX2(const CardSet &board, const CardSet *holes, unsigned int n, unsigned int *keys);
+};
+
+// the server's evaluator
+typedef BasicHandEvaluator<ShortDeck> HandEvaluator;
+typedef BasicHandEvaluator<FullDeck> FullDeckEvaluator;
+
+#endif /* _HANDEVALUATOR_H */
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _HANDEVALUATORTABLES_H
+#define _HANDEVALUATORTABLES_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Card.hpp"
+#include "GameLogic.hpp"
+#include "HandEvaluator.hpp"
+
+/*
+	Generators of the evaluator tables; shared by HandEvaluator and the
+	build-time tool mktables. The small tables indexed by a face mask are
+	generated at compile-time, the non-flush tables are either generated
+	by mktables into an object file or built on first use (see option
+	ENABLE_STATIC_TABLES).
+*/
+
+
+// non-flush hashes are split into rows of 2^RowShift entries
+static constexpr unsigned int RowShift = 9;
+static constexpr unsigned int RowMask = (1 << RowShift) - 1;
+
+// the highest hash of n cards: four of the top face, the rest of the next
+template <class V>
+constexpr unsigned int max_hash(unsigned int n)
+{
+	return 4 * V::faceHash(V::Faces - 1) + (n - 4) * V::faceHash(V::Faces - 2);
+}
+
+template <class V>
+constexpr unsigned int noflush_rows(unsigned int n)
+{
+	return (max_hash<V>(n) >> RowShift) + 1;
+}
+
+// row offsets of 5, 6 and 7 cards are stored back to back
+template <class V>
+constexpr unsigned int row_base(unsigned int n)
+{
+	return (n <= 5) ? 0 : row_base<V>(n - 1) + noflush_rows<V>(n - 1);
+}
+
+template <class V>
+constexpr unsigned int NoFlushRows = row_base<V>(8);
+
+
+// non-flush tables generated by mktables
+template <class V> struct NoFlushData;
+
+template <> struct NoFlushData<ShortDeck>
+{
+	static const unsigned int keys[];
+	static const unsigned int displace[];
+};
+
+template <> struct NoFlushData<FullDeck>
+{
+	static const unsigned int keys[];
+	static const unsigned int displace[];
+};
+
+
+// returns the index of the straight's top face or -1
+template <class V>
+constexpr int straight_high(unsigned int mask)
+{
+	const unsigned int straight = 0x1f;
+	
+	for (int top = V::Faces - 1; top >= 4; top--)
+		if (((mask >> (top - 4)) & straight) == straight)
+			return top;
+	
+	if ((mask & V::StraightWrap) == V::StraightWrap)
+		return 3;
+	
+	return -1;
+}
+
+template <class V>
+constexpr Card::Face face_of(int i)
+{
+	return (Card::Face)(i + V::FirstFace);
+}
+
+// collect the highest faces with at least 'min' cards, skipping 'exclude'
+template <class V>
+constexpr unsigned int top_faces(const unsigned int *count, unsigned int min, unsigned int max,
+	const Card::Face *exclude, unsigned int exclude_count, Card::Face *out)
+{
+	unsigned int n = 0;
+	
+	for (int i = V::Faces - 1; i >= 0 && n < max; i--)
+	{
+		if (count[i] < min)
+			continue;
+		
+		bool excluded = false;
+		for (unsigned int j=0; j < exclude_count; j++)
+			if (exclude[j] == face_of<V>(i))
+				excluded = true;
+		
+		if (!excluded)
+			out[n++] = face_of<V>(i);
+	}
+	
+	return n;
+}
+
+// strength of a multiset of faces without flush
+template <class V>
+constexpr unsigned int rank_faces(const unsigned int *count)
+{
+	typedef BasicHandEvaluator<V> E;
+	
+	Card::Face f[5] = { };
+	unsigned int mask = 0;
+	
+	for (unsigned int i=0; i < V::Faces; i++)
+		if (count[i])
+			mask |= 1 << i;
+	
+	if (top_faces<V>(count, 4, 1, nullptr, 0, f))
+	{
+		top_faces<V>(count, 1, 1, f, 1, f + 1);
+		return E::makeKey(HandStrength::FourOfAKind, f, 2);
+	}
+	
+	if (top_faces<V>(count, 3, 1, nullptr, 0, f) && top_faces<V>(count, 2, 1, f, 1, f + 1))
+		return E::makeKey(HandStrength::FullHouse, f, 2);
+	
+	const int high = straight_high<V>(mask);
+	if (high != -1)
+	{
+		f[0] = face_of<V>(high);
+		return E::makeKey(HandStrength::Straight, f, 1);
+	}
+	
+	if (top_faces<V>(count, 3, 1, nullptr, 0, f))
+	{
+		top_faces<V>(count, 1, 2, f, 1, f + 1);
+		return E::makeKey(HandStrength::ThreeOfAKind, f, 3);
+	}
+	
+	if (top_faces<V>(count, 2, 2, nullptr, 0, f) == 2)
+	{
+		top_faces<V>(count, 1, 1, f, 2, f + 2);
+		return E::makeKey(HandStrength::TwoPair, f, 3);
+	}
+	
+	if (top_faces<V>(count, 2, 1, nullptr, 0, f))
+	{
+		top_faces<V>(count, 1, 3, f, 1, f + 1);
+		return E::makeKey(HandStrength::OnePair, f, 4);
+	}
+	
+	top_faces<V>(count, 1, 5, nullptr, 0, f);
+	return E::makeKey(HandStrength::HighCard, f, 5);
+}
+
+// strength of the cards of the flush suit
+template <class V>
+constexpr unsigned int rank_flush(unsigned int mask)
+{
+	typedef BasicHandEvaluator<V> E;
+	
+	Card::Face f[5] = { };
+	
+	const int high = straight_high<V>(mask);
+	if (high != -1)
+	{
+		f[0] = face_of<V>(high);
+		return E::makeKey(HandStrength::StraightFlush, f, 1);
+	}
+	
+	unsigned int count[V::Faces] = { };
+	for (unsigned int i=0; i < V::Faces; i++)
+		count[i] = (mask >> i) & 1;
+	
+	top_faces<V>(count, 1, 5, nullptr, 0, f);
+	return E::makeKey(HandStrength::Flush, f, 5);
+}
+
+
+// tables indexed by the face mask of one suit
+template <class V>
+struct MaskTables
+{
+	unsigned int flush[1 << V::Faces];
+	
+	// sum of the face hash values of the mask
+	unsigned int mask_hash[1 << V::Faces];
+	
+	unsigned int face_hash[V::Faces];
+};
+
+template <class V>
+constexpr MaskTables<V> make_mask_tables()
+{
+	MaskTables<V> t = { };
+	
+	for (unsigned int i=0; i < V::Faces; i++)
+		t.face_hash[i] = V::faceHash(i);
+	
+	for (unsigned int mask=0; mask < (1 << V::Faces); mask++)
+	{
+		unsigned int bits = 0;
+		for (unsigned int i=0; i < V::Faces; i++)
+		{
+			if (mask & (1 << i))
+			{
+				bits++;
+				t.mask_hash[mask] += V::faceHash(i);
+			}
+		}
+		
+		t.flush[mask] = (bits >= 5) ? rank_flush<V>(mask) : 0;
+	}
+	
+	return t;
+}
+
+
+// collect (hash, key) of all face multisets of 'left' remaining cards
+template <class V>
+inline void collect_noflush(std::vector< std::pair<unsigned int, unsigned int> > *entries,
+	unsigned int *count, unsigned int face, unsigned int left, unsigned int hash)
+{
+	if (face == V::Faces)
+	{
+		if (!left)
+			entries->push_back(std::make_pair(hash, rank_faces<V>(count)));
+		return;
+	}
+	
+	for (unsigned int n=0; n <= 4 && n <= left; n++)
+	{
+		count[face] = n;
+		collect_noflush<V>(entries, count, face + 1, left - n, hash + n * V::faceHash(face));
+	}
+	
+	count[face] = 0;
+}
+
+/*
+	Build the non-flush tables: the key of a hash is found at
+	keys[displace[row_base(n) + (hash >> RowShift)] + (hash & RowMask)].
+	Rows are placed fullest first, each at the first fitting displacement
+	after the last row of its size.
+	Returns false if two face multisets share a hash.
+*/
+template <class V>
+inline bool build_noflush(std::vector<unsigned int> *keys, std::vector<unsigned int> *displace)
+{
+	typedef std::pair<unsigned int, unsigned int> Entry;
+	
+	// next[i] leads to the first free slot at or above i; slots beyond
+	// the end are free
+	std::vector<unsigned int> next;
+	auto find_free = [&next](unsigned int i) {
+		unsigned int r = i;
+		while (r < next.size() && next[r] != r)
+			r = next[r];
+		while (i < next.size() && next[i] != i)
+		{
+			const unsigned int n = next[i];
+			next[i] = r;
+			i = n;
+		}
+		return r;
+	};
+	
+	keys->clear();
+	displace->assign(NoFlushRows<V>, 0);
+	
+	for (unsigned int n=5; n <= 7; n++)
+	{
+		std::vector<Entry> entries;
+		unsigned int count[V::Faces] = { };
+		collect_noflush<V>(&entries, count, 0, n, 0);
+		
+		std::sort(entries.begin(), entries.end());
+		for (unsigned int i=1; i < entries.size(); i++)
+			if (entries[i].first == entries[i - 1].first)
+				return false;
+		
+		std::vector< std::vector<Entry> > rows(noflush_rows<V>(n));
+		for (unsigned int i=0; i < entries.size(); i++)
+			rows[entries[i].first >> RowShift].push_back(entries[i]);
+		
+		std::vector<unsigned int> order;
+		for (unsigned int r=0; r < rows.size(); r++)
+			if (rows[r].size())
+				order.push_back(r);
+		
+		std::stable_sort(order.begin(), order.end(),
+			[&rows](unsigned int a, unsigned int b) { return rows[a].size() > rows[b].size(); });
+		
+		std::vector<unsigned int> hint(64, 0);
+		for (unsigned int r : order)
+		{
+			const std::vector<Entry> &row = rows[r];
+			
+			// try the displacements which put the row's lowest entry on a free
+			// slot; rows of the same size continue where the last one fitted
+			const unsigned int low = row[0].first & RowMask;
+			unsigned int &h = hint[std::min<size_t>(row.size(), hint.size() - 1)];
+			unsigned int slot, d;
+			
+			for (slot = find_free(std::max(low, h)); ; slot = find_free(slot + 1))
+			{
+				d = slot - low;
+				
+				bool fits = true;
+				for (unsigned int i=1; i < row.size() && fits; i++)
+					fits = (find_free((row[i].first & RowMask) + d) == (row[i].first & RowMask) + d);
+				
+				if (fits)
+					break;
+			}
+			
+			h = slot;
+			(*displace)[row_base<V>(n) + r] = d;
+			
+			for (unsigned int i=0; i < row.size(); i++)
+			{
+				const unsigned int idx = (row[i].first & RowMask) + d;
+				if (idx >= next.size())
+				{
+					for (unsigned int j = next.size(); j <= idx; j++)
+						next.push_back(j);
+					keys->resize(idx + 1, 0);
+				}
+				
+				next[idx] = idx + 1;
+				(*keys)[idx] = row[i].second;
+			}
+		}
+	}
+	
+	return true;
+}
+
+#endif /* _HANDEVALUATORTABLES_H */
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstdio>
+#include <cstring>
+
+#include "BoardContext.hpp"
+#include "HandEvaluator.hpp"
+#include "HandStatistics.hpp"
+
+using namespace std;
+
+
+const unsigned int HandStatistics::Categories;
+const unsigned int HandStatistics::Cards;
+const unsigned int HandStatistics::Positions;
+
+static unsigned int card_index(const Card &c)
+{
+	return (c.getFace() - Card::FirstFace) * 4 + (c.getSuit() - Card::FirstSuit);
+}
+
+
+void HandStatistics::clear()
+{
+	hands = 0;
+	player_hands = 0;
+	paired_flops = 0;
+	memset(category, 0, sizeof(category));
+	memset(board_category, 0, sizeof(board_category));
+	memset(flop_texture, 0, sizeof(flop_texture));
+	memset(card_position, 0, sizeof(card_position));
+}
+
+bool HandStatistics::add(const HoleCards *holes, unsigned int players, const CommunityCards *cc)
+{
+	if (cc->size() != 5 || !players)
+		return false;
+	
+	const Card *board = cc->begin();
+	
+	BoardContext context;
+	for (unsigned int i=0; i < 5; i++)
+		context.add(board[i]);
+	
+	for (unsigned int p=0; p < players; p++)
+	{
+		const unsigned int key = context.evaluate(&holes[p]);
+		if (!key)
+			return false;
+		
+		category[HandEvaluator::getRanking(key)]++;
+	}
+	
+	Card c1, c2;
+	holes[0].getCards(&c1, &c2);
+	card_position[0][card_index(c1)]++;
+	card_position[1][card_index(c2)]++;
+	
+	for (unsigned int i=0; i < 5; i++)
+		card_position[2 + i][card_index(board[i])]++;
+	
+	board_category[HandEvaluator::getRanking(HandEvaluator::evaluate(board, 5))]++;
+	
+	// flop texture by the number of suits
+	const CardSet flop = CardSet(board[0]) | CardSet(board[1]) | CardSet(board[2]);
+	unsigned int suits = 0;
+	for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+		if (flop.getSuitMask((Card::Suit)s))
+			suits++;
+	
+	flop_texture[(suits == 3) ? Rainbow : (suits == 2) ? TwoTone : Monotone]++;
+	
+	if (CardSet::popcount(flop.getFaceMask()) < 3)
+		paired_flops++;
+	
+	hands++;
+	player_hands += players;
+	
+	return true;
+}
+
+void HandStatistics::merge(const HandStatistics &s)
+{
+	hands += s.hands;
+	player_hands += s.player_hands;
+	paired_flops += s.paired_flops;
+	
+	for (unsigned int i=0; i < Categories; i++)
+	{
+		category[i] += s.category[i];
+		board_category[i] += s.board_category[i];
+	}
+	
+	for (unsigned int i=0; i < Textures; i++)
+		flop_texture[i] += s.flop_texture[i];
+	
+	for (unsigned int p=0; p < Positions; p++)
+		for (unsigned int c=0; c < Cards; c++)
+			card_position[p][c] += s.card_position[p][c];
+}
+
+double HandStatistics::getChiSquare(unsigned int pos) const
+{
+	if (!hands)
+		return 0;
+	
+	const double expected = (double)hands / Cards;
+	double chi2 = 0;
+	
+	for (unsigned int c=0; c < Cards; c++)
+	{
+		const double d = card_position[pos][c] - expected;
+		chi2 += d * d / expected;
+	}
+	
+	return chi2;
+}
+
+static void write_row(FILE *fp, const char *name, const unsigned long *values, unsigned int count)
+{
+	fprintf(fp, "%s", name);
+	for (unsigned int i=0; i < count; i++)
+		fprintf(fp, " %lu", values[i]);
+	fprintf(fp, "\n");
+}
+
+static bool read_row(FILE *fp, const char *name, unsigned long *values, unsigned int count)
+{
+	char word[32];
+	if (fscanf(fp, "%31s", word) != 1 || strcmp(word, name))
+		return false;
+	
+	for (unsigned int i=0; i < count; i++)
+		if (fscanf(fp, "%lu", &values[i]) != 1)
+			return false;
+	
+	return true;
+}
+
+bool HandStatistics::save(const char *filename) const
+{
+	// write a new file and replace the old one, so a checkpoint is never half-written
+	char tmpname[1024];
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+	
+	FILE *fp = fopen(tmpname, "w");
+	if (!fp)
+		return false;
+	
+	fprintf(fp, "# hand statistics\n");
+	write_row(fp, "hands", &hands, 1);
+	write_row(fp, "player_hands", &player_hands, 1);
+	write_row(fp, "category", category, Categories);
+	write_row(fp, "board_category", board_category, Categories);
+	write_row(fp, "flop_texture", flop_texture, Textures);
+	write_row(fp, "paired_flops", &paired_flops, 1);
+	for (unsigned int p=0; p < Positions; p++)
+		write_row(fp, "card_position", card_position[p], Cards);
+	
+	const bool ok = !ferror(fp);
+	if (fclose(fp) || !ok)
+	{
+		remove(tmpname);
+		return false;
+	}
+	
+#if defined(PLATFORM_WINDOWS)
+	remove(filename);
+#endif
+	
+	return rename(tmpname, filename) == 0;
+}
+
+bool HandStatistics::load(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+		return false;
+	
+	HandStatistics s;
+	char comment[64];
+	
+	bool ok = fgets(comment, sizeof(comment), fp) && comment[0] == '#' &&
+		read_row(fp, "hands", &s.hands, 1) &&
+		read_row(fp, "player_hands", &s.player_hands, 1) &&
+		read_row(fp, "category", s.category, Categories) &&
+		read_row(fp, "board_category", s.board_category, Categories) &&
+		read_row(fp, "flop_texture", s.flop_texture, Textures) &&
+		read_row(fp, "paired_flops", &s.paired_flops, 1);
+	
+	for (unsigned int p=0; ok && p < Positions; p++)
+		ok = read_row(fp, "card_position", s.card_position[p], Cards);
+	
+	fclose(fp);
+	
+	if (!ok)
+		return false;
+	
+	*this = s;
+	return true;
+}
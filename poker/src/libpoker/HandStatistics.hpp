@@ -0,0 +1,86 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _HANDSTATISTICS_H
+#define _HANDSTATISTICS_H
+
+#include "Card.hpp"
+#include "HoleCards.hpp"
+#include "CommunityCards.hpp"
+#include "GameLogic.hpp"
+
+/*
+	Counters over dealt hands for auditing the dealing: hand and board
+	categories, flop textures and how often each card shows up at each
+	dealing position. Each thread fills a shard of its own; shards are
+	merged and saved as a text checkpoint that load() resumes from.
+*/
+
+class HandStatistics
+{
+public:
+	static const unsigned int Categories = HandStrength::StraightFlush + 1;
+	static const unsigned int Cards = 36;
+	static const unsigned int Positions = 7;  // hole-cards of the first player, flop, turn, river
+	
+	typedef enum {
+		Rainbow,
+		TwoTone,
+		Monotone,
+		
+		Textures
+	} FlopTexture;
+	
+	HandStatistics() { clear(); };
+	
+	void clear();
+	
+	// a dealt hand: hole-cards of the players in dealing order and a complete board
+	bool add(const HoleCards *holes, unsigned int players, const CommunityCards *cc);
+	void merge(const HandStatistics &s);
+	
+	bool save(const char *filename) const;
+	bool load(const char *filename);
+	
+	unsigned long getHands() const { return hands; };
+	unsigned long getPlayerHands() const { return player_hands; };
+	unsigned long getCategory(unsigned int c) const { return category[c]; };
+	unsigned long getBoardCategory(unsigned int c) const { return board_category[c]; };
+	unsigned long getFlopTexture(FlopTexture t) const { return flop_texture[t]; };
+	unsigned long getPairedFlops() const { return paired_flops; };
+	unsigned long getCardCount(unsigned int pos, unsigned int card) const { return card_position[pos][card]; };
+	
+	// chi-square statistic of the card distribution at a position (35 degrees of freedom)
+	double getChiSquare(unsigned int pos) const;
+	
+private:
+	unsigned long hands;
+	unsigned long player_hands;
+	unsigned long category[Categories];        // of each player's hand
+	unsigned long board_category[Categories];  // of the board alone
+	unsigned long flop_texture[Textures];
+	unsigned long paired_flops;
+	unsigned long card_position[Positions][Cards];
+};
+
+#endif /* _HANDSTATISTICS_H */
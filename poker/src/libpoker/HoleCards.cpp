@@ -26,21 +26,35 @@
 
 using namespace std;
 
+const unsigned int HoleCards::Capacity;
+
 HoleCards::HoleCards()
+	: count(0)
 {
 
 }
 
 bool HoleCards::setCards(Card c1, Card c2)
 {
-	cards.clear();
-	cards.push_back(c1);
-	cards.push_back(c2);
+	cards[0] = c1;
+	cards[1] = c2;
+	count = 2;
+	
+	return true;
+}
+
+bool HoleCards::getCards(Card *c1, Card *c2) const
+{
+	if (count != 2)
+		return false;
+	
+	*c1 = cards[0];
+	*c2 = cards[1];
 	
 	return true;
 }
 
 void HoleCards::debug()
 {
-	print_cards("Hole", &cards);
+	print_cards("Hole", cards, count);
 }
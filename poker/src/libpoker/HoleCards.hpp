@@ -27,20 +27,32 @@
 #include <vector>
 
 #include "Card.hpp"
+#include "CardSet.hpp"
 
+/* the cards are stored inline; begin()/end() read them without copying */
 class HoleCards
 {
 public:
+	static const unsigned int Capacity = 2;
+	
 	HoleCards();
 	
 	bool setCards(Card c1, Card c2);
-	void clear() { cards.clear(); };
+	bool getCards(Card *c1, Card *c2) const;
+	void clear() { count = 0; };
+	
+	unsigned int size() const { return count; };
+	const Card* begin() const { return cards; };
+	const Card* end() const { return cards + count; };
+	const Card& operator[] (unsigned int i) const { return cards[i]; };
 	
-	void copyCards(std::vector<Card> *v) const { v->insert(v->end(), cards.begin(), cards.end()); };
+	void copyCards(std::vector<Card> *v) const { v->insert(v->end(), begin(), end()); };
+	void copyCards(CardSet *s) const { for (unsigned int i=0; i < count; i++) s->add(cards[i]); };
 	
 	void debug();
 private:
-	std::vector<Card> cards;
+	Card cards[Capacity];
+	unsigned char count;
 };
 
 #endif /* _HOLECARDS_H */
@@ -34,6 +34,7 @@ class Player
 {
 friend class GameController;
 friend class TestCaseGameController;
+friend class TableBench;
 
 public:
 	typedef enum {
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#if !defined(PLATFORM_WINDOWS)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "PreflopEquity.hpp"
+
+using namespace std;
+
+
+const unsigned int PreflopEquity::Cards;
+const unsigned int PreflopEquity::Hands;
+const uint16_t PreflopEquity::NoMatchup;
+const uint32_t PreflopEquity::Version;
+
+static const char magic[8] = { 'H', 'N', 'P', 'F', 'E', 'Q', '\r', '\n' };
+
+
+PreflopEquity::PreflopEquity()
+	: header(0), matchups(0), entries(0), data(0), size(0)
+{
+	
+}
+
+PreflopEquity::~PreflopEquity()
+{
+	unload();
+}
+
+bool PreflopEquity::load(const char *filename)
+{
+	unload();
+	
+#if defined(PLATFORM_WINDOWS)
+	// no mmap; read the file in one go
+	FILE *fp = fopen(filename, "rb");
+	if (!fp)
+		return false;
+	
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	
+	data = malloc(size);
+	const bool ok = data && fread(data, 1, size, fp) == size;
+	fclose(fp);
+	
+	if (!ok)
+	{
+		free(data);
+		data = 0;
+		return false;
+	}
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		return false;
+	
+	struct stat st;
+	if (fstat(fd, &st) == -1 || !st.st_size)
+	{
+		close(fd);
+		return false;
+	}
+	
+	size = st.st_size;
+	data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	
+	if (data == MAP_FAILED)
+	{
+		data = 0;
+		return false;
+	}
+#endif
+	
+	const Header *h = (const Header*) data;
+	const size_t table_size = sizeof(Header) + Hands * Hands * sizeof(uint16_t);
+	
+	if (size < table_size ||
+		memcmp(h->magic, magic, sizeof(magic)) ||
+		h->version != Version ||
+		h->hands != Hands ||
+		size != table_size + h->classes * sizeof(Entry))
+	{
+		unload();
+		return false;
+	}
+	
+	// lookups trust the table; every class must have an entry
+	const uint16_t *m = (const uint16_t*) (h + 1);
+	for (unsigned int i=0; i < Hands * Hands; i++)
+	{
+		if (m[i] != NoMatchup && m[i] >= h->classes)
+		{
+			unload();
+			return false;
+		}
+	}
+	
+	header = h;
+	matchups = (const uint16_t*) (header + 1);
+	entries = (const Entry*) (matchups + Hands * Hands);
+	
+	return true;
+}
+
+void PreflopEquity::unload()
+{
+	if (data)
+	{
+#if defined(PLATFORM_WINDOWS)
+		free(data);
+#else
+		munmap(data, size);
+#endif
+	}
+	
+	header = 0;
+	matchups = 0;
+	entries = 0;
+	data = 0;
+	size = 0;
+}
+
+bool PreflopEquity::lookup(unsigned int a, unsigned int b, double *equity, double *tie) const
+{
+	if (!header || a >= Hands || b >= Hands)
+		return false;
+	
+	const uint16_t c = matchups[a * Hands + b];
+	if (c == NoMatchup)
+		return false;
+	
+	const Entry &e = entries[c];
+	const double runouts = header->runouts;
+	
+	*equity = (e.wins + e.ties * 0.5) / runouts;
+	if (tie)
+		*tie = e.ties / runouts;
+	
+	return true;
+}
+
+bool PreflopEquity::lookup(const Card &a1, const Card &a2, const Card &b1, const Card &b2,
+	double *equity, double *tie) const
+{
+	return lookup(getHandIndex(a1, a2), getHandIndex(b1, b2), equity, tie);
+}
+
+void PreflopEquity::fillHeader(Header *h, unsigned int classes, unsigned int runouts)
+{
+	memset(h, 0, sizeof(Header));
+	memcpy(h->magic, magic, sizeof(magic));
+	h->version = Version;
+	h->hands = Hands;
+	h->classes = classes;
+	h->runouts = runouts;
+}
+
+unsigned int PreflopEquity::getHandIndex(const Card &c1, const Card &c2)
+{
+	unsigned int i = getCardIndex(c1), j = getCardIndex(c2);
+	
+	if (i == j)
+		return Hands;  // not a hand
+	
+	if (i > j)
+	{
+		const unsigned int t = i;
+		i = j;
+		j = t;
+	}
+	
+	return j * (j - 1) / 2 + i;
+}
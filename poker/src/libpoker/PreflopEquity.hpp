@@ -0,0 +1,92 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _PREFLOPEQUITY_H
+#define _PREFLOPEQUITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Card.hpp"
+
+/*
+	Exact heads-up preflop equity of every pair of short-deck starting
+	hands, read from a file written by the preflopdb tool. The file is
+	mapped into memory as is; a lookup is two array reads.
+	
+	File layout (native byte order):
+	  Header
+	  uint16_t  matchup[Hands][Hands]  class of each pair, NoMatchup if
+	                                   the hands share a card
+	  Entry     entries[classes]       one per class of pairs equal up
+	                                   to a permutation of suits
+*/
+
+class PreflopEquity
+{
+public:
+	static const unsigned int Cards = 36;
+	static const unsigned int Hands = Cards * (Cards - 1) / 2;
+	static const uint16_t NoMatchup = 0xffff;
+	static const uint32_t Version = 1;
+	
+	typedef struct {
+		char magic[8];       // "HNPFEQ\r\n"
+		uint32_t version;
+		uint32_t hands;      // Hands
+		uint32_t classes;
+		uint32_t runouts;    // boards per matchup
+	} Header;
+	
+	typedef struct {
+		uint32_t wins;       // boards won by the first hand
+		uint32_t ties;
+	} Entry;
+	
+	PreflopEquity();
+	~PreflopEquity();
+	
+	bool load(const char *filename);
+	void unload();
+	bool isLoaded() const { return header != 0; };
+	
+	// equity of hand a against hand b; false if not loaded or the hands overlap
+	bool lookup(const Card &a1, const Card &a2, const Card &b1, const Card &b2,
+		double *equity, double *tie=0) const;
+	bool lookup(unsigned int a, unsigned int b, double *equity, double *tie=0) const;
+	
+	static void fillHeader(Header *h, unsigned int classes, unsigned int runouts);
+	static unsigned int getCardIndex(const Card &c)
+		{ return (c.getFace() - Card::FirstFace) * 4 + (c.getSuit() - Card::FirstSuit); };
+	static unsigned int getHandIndex(const Card &c1, const Card &c2);
+	
+private:
+	const Header *header;
+	const uint16_t *matchups;
+	const Entry *entries;
+	
+	void *data;
+	size_t size;
+};
+
+#endif /* _PREFLOPEQUITY_H */
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Range.hpp"
+
+using namespace std;
+
+
+static const char face_symbols[] = "6789TJQKA";
+static const char suit_symbols[] = "cdhs";
+
+static bool parse_face(char c, Card::Face *f)
+{
+	const char *p = c ? strchr(face_symbols, c) : 0;
+	if (!p)
+		return false;
+	
+	*f = (Card::Face)(Card::FirstFace + (p - face_symbols));
+	return true;
+}
+
+static bool parse_suit(char c, Card::Suit *s)
+{
+	const char *p = c ? strchr(suit_symbols, c) : 0;
+	if (!p)
+		return false;
+	
+	*s = (Card::Suit)(Card::FirstSuit + (p - suit_symbols));
+	return true;
+}
+
+static unsigned int card_index(const Card &c)
+{
+	return (c.getFace() - Card::FirstFace) * 4 + (c.getSuit() - Card::FirstSuit);
+}
+
+
+void Range::clear()
+{
+	combos.clear();
+	memset(index, -1, sizeof(index));
+}
+
+bool Range::add(const Card &c1, const Card &c2, double weight)
+{
+	if (c1.getFace() < Card::FirstFace || c1.getFace() > Card::LastFace
+		|| c2.getFace() < Card::FirstFace || c2.getFace() > Card::LastFace)
+		return false;
+	
+	const unsigned int i1 = card_index(c1), i2 = card_index(c2);
+	
+	if (i1 == i2)
+		return false;
+	
+	short &pos = index[i1 < i2 ? i1 : i2][i1 < i2 ? i2 : i1];
+	
+	if (pos != -1)
+	{
+		if (weight > 0)
+		{
+			combos[pos].weight = weight;
+			return true;
+		}
+		
+		// move the last combo into the gap
+		const Combo &last = combos.back();
+		const unsigned int l1 = card_index(last.c1), l2 = card_index(last.c2);
+		index[l1 < l2 ? l1 : l2][l1 < l2 ? l2 : l1] = pos;
+		combos[pos] = last;
+		combos.pop_back();
+		pos = -1;
+		return true;
+	}
+	
+	if (weight <= 0)
+		return true;
+	
+	Combo c;
+	c.c1 = c1;
+	c.c2 = c2;
+	c.cards = CardSet(c1) | CardSet(c2);
+	c.weight = weight;
+	
+	pos = combos.size();
+	combos.push_back(c);
+	
+	return true;
+}
+
+double Range::getTotalWeight() const
+{
+	double total = 0;
+	for (unsigned int i=0; i < combos.size(); i++)
+		total += combos[i].weight;
+	return total;
+}
+
+bool Range::parseToken(const string &token)
+{
+	string hand = token;
+	double weight = 1.0;
+	
+	const string::size_type colon = token.find(':');
+	if (colon != string::npos)
+	{
+		const string w = token.substr(colon + 1);
+		char *end;
+		weight = strtod(w.c_str(), &end);
+		if (w.empty() || *end || weight < 0)
+			return false;
+		
+		hand = token.substr(0, colon);
+	}
+	
+	Card::Face f1, f2;
+	Card::Suit s1, s2;
+	
+	// single combo
+	if (hand.size() == 4 &&
+		parse_face(hand[0], &f1) && parse_suit(hand[1], &s1) &&
+		parse_face(hand[2], &f2) && parse_suit(hand[3], &s2))
+	{
+		if (f1 == f2 && s1 == s2)
+			return false;
+		
+		add(Card(f1, s1), Card(f2, s2), weight);
+		return true;
+	}
+	
+	if (hand.size() < 2 || !parse_face(hand[0], &f1) || !parse_face(hand[1], &f2))
+		return false;
+	
+	string::size_type pos = 2;
+	char kind = 0;  // 's', 'o' or all combos
+	if (pos < hand.size() && (hand[pos] == 's' || hand[pos] == 'o'))
+		kind = hand[pos++];
+	
+	if (f1 == f2 && kind)
+		return false;
+	
+	if (f1 < f2)
+	{
+		const Card::Face t = f1;
+		f1 = f2;
+		f2 = t;
+	}
+	
+	// the second face runs from lo to hi; a pair moves both faces
+	int lo = f2, hi = f2;
+	
+	if (pos < hand.size() && hand[pos] == '+')
+	{
+		hi = (f1 == f2) ? (int)Card::LastFace : f1 - 1;
+		pos++;
+	}
+	else if (pos < hand.size() && hand[pos] == '-')
+	{
+		// the end of the range must look like the start
+		const string end = hand.substr(pos + 1);
+		Card::Face e1, e2;
+		
+		if (end.size() != pos || !parse_face(end[0], &e1) || !parse_face(end[1], &e2) ||
+			(kind && end[2] != kind))
+			return false;
+		
+		if (f1 == f2)
+		{
+			if (e1 != e2)
+				return false;
+		}
+		else if (e1 < e2 || e1 != f1 || e1 == e2)
+			return false;
+		
+		lo = (e2 < f2) ? e2 : f2;
+		hi = (e2 < f2) ? f2 : e2;
+		pos = hand.size();
+	}
+	
+	if (pos != hand.size())
+		return false;
+	
+	for (int k=lo; k <= hi; k++)
+	{
+		const Card::Face a = (f1 == f2) ? (Card::Face)k : f1;
+		const Card::Face b = (Card::Face)k;
+		
+		for (int i=Card::FirstSuit; i <= Card::LastSuit; i++)
+			for (int j=Card::FirstSuit; j <= Card::LastSuit; j++)
+			{
+				if (a == b ? j <= i : (kind == 's' ? i != j : kind == 'o' && i == j))
+					continue;
+				
+				add(Card(a, (Card::Suit)i), Card(b, (Card::Suit)j), weight);
+			}
+	}
+	
+	return true;
+}
+
+bool Range::parse(const char *str)
+{
+	Range r;
+	string s(str);
+	string::size_type start = 0;
+	
+	while (start <= s.size())
+	{
+		string::size_type end = s.find(',', start);
+		if (end == string::npos)
+			end = s.size();
+		
+		// strip blanks
+		string token = s.substr(start, end - start);
+		const string::size_type first = token.find_first_not_of(" \t");
+		const string::size_type last = token.find_last_not_of(" \t");
+		token = (first == string::npos) ? string() : token.substr(first, last - first + 1);
+		
+		if (token.empty() || !r.parseToken(token))
+			return false;
+		
+		start = end + 1;
+	}
+	
+	*this = r;
+	return true;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _RANGE_H
+#define _RANGE_H
+
+#include <string>
+#include <vector>
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+
+/*
+	A weighted set of short-deck starting hands ("combos").
+	
+	parse() reads a comma separated list of
+	  AA  AKs  AKo  AK    a pair, suited, offsuit or all combos
+	  TT+  KTs+  KTo+     pairs from TT up; kicker from T up to below K
+	  99-77  A9s-A6s      pairs or kickers between both, inclusive
+	  AsKd                a single combo
+	each optionally followed by ":<weight>". A combo listed again takes
+	the latest weight; a weight of 0 removes it.
+*/
+
+class Range
+{
+public:
+	typedef struct {
+		Card c1, c2;
+		CardSet cards;
+		double weight;
+	} Combo;
+	
+	Range() { clear(); };
+	
+	bool parse(const char *str);
+	
+	// false if a card is not part of the deck or both are the same
+	bool add(const Card &c1, const Card &c2, double weight = 1.0);
+	void clear();
+	
+	unsigned int count() const { return combos.size(); };
+	const std::vector<Combo>& getCombos() const { return combos; };
+	double getTotalWeight() const;
+	
+private:
+	bool parseToken(const std::string &token);
+	
+	std::vector<Combo> combos;
+	short index[36][36];  // position in combos by card index, or -1
+};
+
+#endif /* _RANGE_H */
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+
+struct ThreadPool::Job
+{
+	const function<void(unsigned int)> *task;
+	unsigned int count;
+	
+	// guarded by the pool's mutex
+	unsigned int next;
+	unsigned int done;
+	unsigned int active;  // threads working on the job
+	condition_variable finished;
+};
+
+
+ThreadPool::ThreadPool(unsigned int threads) : stop(false)
+{
+	if (!threads)
+		threads = max(1u, thread::hardware_concurrency());
+	
+	// the caller of run() is the remaining thread
+	for (unsigned int i=1; i < threads; i++)
+		workers.push_back(thread(&ThreadPool::worker, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	
+	wakeup.notify_all();
+	
+	for (unsigned int i=0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::run(unsigned int count, const function<void(unsigned int)> &task)
+{
+	if (!count)
+		return;
+	
+	Job job;
+	job.task = &task;
+	job.count = count;
+	job.next = 0;
+	job.done = 0;
+	job.active = 0;
+	
+	unique_lock<std::mutex> lock(mutex);
+	
+	if (workers.size() && count > 1)
+	{
+		jobs.push_back(&job);
+		wakeup.notify_all();
+	}
+	
+	work(&job, lock);
+	
+	// the job lives on this stack; wait until no worker touches it
+	job.finished.wait(lock, [&job]() { return job.done == job.count && !job.active; });
+}
+
+void ThreadPool::worker()
+{
+	unique_lock<std::mutex> lock(mutex);
+	
+	for (;;)
+	{
+		wakeup.wait(lock, [this]() { return stop || !jobs.empty(); });
+		
+		if (stop)
+			return;
+		
+		work(jobs.front(), lock);
+	}
+}
+
+// called and returns with the mutex locked
+void ThreadPool::work(Job *job, unique_lock<std::mutex> &lock)
+{
+	job->active++;
+	
+	while (job->next < job->count)
+	{
+		const unsigned int i = job->next++;
+		
+		// all indices are handed out; no more threads needed
+		if (job->next == job->count)
+		{
+			deque<Job*>::iterator e = find(jobs.begin(), jobs.end(), job);
+			if (e != jobs.end())
+				jobs.erase(e);
+		}
+		
+		lock.unlock();
+		(*job->task)(i);
+		lock.lock();
+		
+		job->done++;
+	}
+	
+	job->active--;
+	
+	if (job->done == job->count && !job->active)
+		job->finished.notify_all();
+}
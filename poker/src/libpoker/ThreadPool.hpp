@@ -0,0 +1,66 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Fixed set of worker threads running parallel loops. run() hands out
+	the indices 0..count-1 to the workers and blocks until all are done;
+	the calling thread works on its own loop, too. Several threads may
+	call run() at the same time.
+*/
+
+class ThreadPool
+{
+public:
+	// 0 threads: one per hardware thread
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+	
+	unsigned int size() const { return workers.size() + 1; };
+	
+	void run(unsigned int count, const std::function<void(unsigned int)> &task);
+	
+private:
+	struct Job;
+	
+	void worker();
+	void work(Job *job, std::unique_lock<std::mutex> &lock);
+	
+	std::vector<std::thread> workers;
+	std::deque<Job*> jobs;
+	
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool stop;
+};
+
+#endif /* _THREADPOOL_H */
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _VARIANT_H
+#define _VARIANT_H
+
+#include "Card.hpp"
+
+/*
+	Compile-time policies of the hold'em variants; a policy is passed to
+	BasicHandEvaluator so each variant gets its own specialized evaluator.
+	
+	  FirstFace    lowest face of the deck; the Ace is always the highest
+	  Faces        number of faces per suit
+	  faceHash()   per-face hash values; sums of 5, 6 or 7 of them are
+	               unique per card count
+	  order()      category order, indexed by HandStrength::Ranking
+	  StraightWrap face-index mask of the lowest straight, where the
+	               Ace acts as the lowest card
+*/
+
+// 6+ hold'em: 36 cards; a Flush beats a FullHouse
+struct ShortDeck
+{
+	static constexpr Card::Face FirstFace = Card::Six;
+	static constexpr unsigned int Faces = Card::Ace - FirstFace + 1;
+	
+	static constexpr unsigned int faceHash(unsigned int i)
+	{
+		const unsigned int hash[Faces] = {
+			0, 1, 5, 22, 98, 453, 2031, 8698, 22854
+		};
+		return hash[i];
+	};
+	
+	static constexpr unsigned int order(unsigned int ranking)
+	{
+		const unsigned int ord[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+		return ord[ranking];
+	};
+	
+	// A6789
+	static constexpr unsigned int StraightWrap = (1 << (Faces - 1)) | 0xf;
+};
+
+// Texas hold'em: 52 cards; a FullHouse beats a Flush
+struct FullDeck
+{
+	static constexpr Card::Face FirstFace = Card::Two;
+	static constexpr unsigned int Faces = Card::Ace - FirstFace + 1;
+	
+	static constexpr unsigned int faceHash(unsigned int i)
+	{
+		const unsigned int hash[Faces] = {
+			0, 1, 5, 22, 98, 453, 2031, 8698, 22854,
+			83661, 262349, 636345, 1479181
+		};
+		return hash[i];
+	};
+	
+	static constexpr unsigned int order(unsigned int ranking)
+	{
+		const unsigned int ord[] = { 0, 1, 2, 3, 4, 6, 5, 7, 8 };
+		return ord[ranking];
+	};
+	
+	// A2345
+	static constexpr unsigned int StraightWrap = (1 << (Faces - 1)) | 0xf;
+};
+
+#endif /* _VARIANT_H */
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+/*
+	Build-time generator of the evaluator's non-flush tables. Writes a
+	C++ source file defining NoFlushData of all variants, compiled into
+	libpoker, so the server starts without a table init step.
+*/
+
+#include <cstdio>
+#include <vector>
+
+#include "HandEvaluatorTables.hpp"
+
+using namespace std;
+
+
+static void write_array(FILE *fp, const char *name, const vector<unsigned int> &v)
+{
+	fprintf(fp, "const unsigned int %s[%u] = {", name, (unsigned int)v.size());
+	
+	for (unsigned int i=0; i < v.size(); i++)
+		fprintf(fp, "%s0x%x,", (i % 16) ? "" : "\n\t", v[i]);
+	
+	fprintf(fp, "\n};\n\n");
+}
+
+template <class V>
+static bool write_tables(FILE *fp, const char *variant)
+{
+	vector<unsigned int> keys, displace;
+	
+	if (!build_noflush<V>(&keys, &displace))
+	{
+		fprintf(stderr, "%s: face hash values are not unique\n", variant);
+		return false;
+	}
+	
+	char name[64];
+	
+	snprintf(name, sizeof(name), "NoFlushData<%s>::keys", variant);
+	write_array(fp, name, keys);
+	
+	snprintf(name, sizeof(name), "NoFlushData<%s>::displace", variant);
+	write_array(fp, name, displace);
+	
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <output.cpp>\n", argv[0]);
+		return 1;
+	}
+	
+	FILE *fp = fopen(argv[1], "w");
+	if (!fp)
+	{
+		perror("fopen");
+		return 1;
+	}
+	
+	fprintf(fp, "/* generated by mktables; do not edit */\n\n");
+	fprintf(fp, "#include \"HandEvaluatorTables.hpp\"\n\n");
+	
+	if (!write_tables<ShortDeck>(fp, "ShortDeck") || !write_tables<FullDeck>(fp, "FullDeck"))
+	{
+		fclose(fp);
+		remove(argv[1]);
+		return 1;
+	}
+	
+	if (fclose(fp))
+	{
+		perror("fclose");
+		return 1;
+	}
+	
+	return 0;
+}
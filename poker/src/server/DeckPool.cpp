@@ -0,0 +1,136 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <chrono>
+
+#include "DeckPool.hpp"
+
+using namespace std;
+
+
+const unsigned int DeckPool::Cards;
+
+DeckPool::DeckPool(unsigned int capacity)
+	: head(0), tail(0), hits(0), misses(0), stop(false)
+{
+	unsigned int size = 2;
+	while (size < capacity)
+		size *= 2;
+	
+	slots = new Slot[size];
+	mask = size - 1;
+	
+	for (unsigned int i=0; i < size; i++)
+		slots[i].seq.store(i, memory_order_relaxed);
+	
+	thread = std::thread(&DeckPool::run, this);
+}
+
+DeckPool::~DeckPool()
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		stop.store(true);
+	}
+	
+	wakeup.notify_one();
+	thread.join();
+	
+	delete[] slots;
+}
+
+bool DeckPool::pop(Deck *deck)
+{
+	unsigned int pos = tail.load(memory_order_relaxed);
+	Slot *slot;
+	
+	for (;;)
+	{
+		slot = &slots[pos & mask];
+		const int diff = (int)(slot->seq.load(memory_order_acquire) - (pos + 1));
+		
+		if (diff == 0)
+		{
+			// claim it; on failure pos holds the new tail
+			if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			misses.fetch_add(1, memory_order_relaxed);
+			wakeup.notify_one();
+			return false;
+		}
+		else
+			pos = tail.load(memory_order_relaxed);
+	}
+	
+	deck->load(slot->cards, Cards);
+	slot->seq.store(pos + mask + 1, memory_order_release);
+	
+	hits.fetch_add(1, memory_order_relaxed);
+	wakeup.notify_one();
+	
+	return true;
+}
+
+void DeckPool::getStats(unsigned long *hits, unsigned long *misses) const
+{
+	*hits = this->hits.load(memory_order_relaxed);
+	*misses = this->misses.load(memory_order_relaxed);
+}
+
+bool DeckPool::full() const
+{
+	const unsigned int pos = head.load(memory_order_relaxed);
+	return slots[pos & mask].seq.load(memory_order_acquire) != pos;
+}
+
+void DeckPool::run()
+{
+	Deck deck(rng);
+	
+	while (!stop)
+	{
+		if (full())
+		{
+			// a wakeup sent between the check and the wait is caught by the timeout
+			unique_lock<std::mutex> lock(mutex);
+			wakeup.wait_for(lock, chrono::milliseconds(100), [this] { return stop || !full(); });
+			continue;
+		}
+		
+		const unsigned int pos = head.load(memory_order_relaxed);
+		Slot *slot = &slots[pos & mask];
+		
+		deck.fill();
+		deck.shuffle();
+		
+		Card c;
+		for (unsigned int i=0; deck.pop(c); i++)
+			slot->cards[i] = c.getCode();
+		
+		slot->seq.store(pos + 1, memory_order_release);
+		head.store(pos + 1, memory_order_relaxed);
+	}
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _DECKPOOL_H
+#define _DECKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Card.hpp"
+#include "Deck.hpp"
+#include "ChaCha20.hpp"
+
+/*
+	Background thread keeping a bounded pool of shuffled short decks, so
+	a table starting a new hand only copies 36 bytes. The pool is a ring
+	of slots with sequence numbers: taking a deck never blocks and is
+	safe from any number of threads. If the pool runs dry, pop() fails and
+	the caller shuffles inline.
+*/
+
+class DeckPool
+{
+public:
+	static const unsigned int Cards = (Card::LastFace - Card::FirstFace + 1) * 4;
+	
+	// capacity is rounded up to a power of two
+	explicit DeckPool(unsigned int capacity = 1024);
+	~DeckPool();
+	
+	// replace the cards of deck by a shuffled short deck
+	bool pop(Deck *deck);
+	
+	void getStats(unsigned long *hits, unsigned long *misses) const;
+	
+private:
+	typedef struct {
+		std::atomic<unsigned int> seq;  // pos if free, pos+1 if filled
+		unsigned char cards[Cards];
+	} Slot;
+	
+	void run();
+	bool full() const;
+	
+	Slot *slots;
+	unsigned int mask;
+	
+	std::atomic<unsigned int> head;  // next slot to fill; producer only
+	std::atomic<unsigned int> tail;  // next slot to take
+	
+	std::atomic<unsigned long> hits, misses;
+	
+	ChaCha20 rng;  // producer only
+	
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::atomic<bool> stop;
+	
+	std::thread thread;
+};
+
+#endif /* _DECKPOOL_H */
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include "EquityWorker.hpp"
+
+using namespace std;
+
+
+EquityWorker::EquityWorker(unsigned int threads)
+	: engine(threads), cache(&engine, 4096), last_id(0), running_game(-1), running_table(-1),
+	  running_cancelled(false), stop(false)
+{
+	thread = std::thread(&EquityWorker::run, this);
+}
+
+EquityWorker::~EquityWorker()
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	
+	wakeup.notify_one();
+	thread.join();
+}
+
+unsigned int EquityWorker::submit(const Job &job)
+{
+	lock_guard<std::mutex> lock(mutex);
+	
+	drop(job.game_id, job.table_id);
+	
+	jobs.push_back(job);
+	jobs.back().id = ++last_id;
+	
+	wakeup.notify_one();
+	
+	return last_id;
+}
+
+void EquityWorker::cancel(int game_id, int table_id)
+{
+	lock_guard<std::mutex> lock(mutex);
+	drop(game_id, table_id);
+}
+
+void EquityWorker::drop(int game_id, int table_id)
+{
+	for (deque<Job>::iterator e = jobs.begin(); e != jobs.end();)
+	{
+		if (e->game_id == game_id && (table_id == -1 || e->table_id == table_id))
+			e = jobs.erase(e);
+		else
+			++e;
+	}
+	
+	for (vector<Result>::iterator e = results.begin(); e != results.end();)
+	{
+		if (e->game_id == game_id && (table_id == -1 || e->table_id == table_id))
+			e = results.erase(e);
+		else
+			++e;
+	}
+	
+	if (running_game == game_id && (table_id == -1 || running_table == table_id))
+		running_cancelled = true;
+}
+
+bool EquityWorker::collect(int game_id, vector<Result> *collected)
+{
+	lock_guard<std::mutex> lock(mutex);
+	
+	bool found = false;
+	
+	for (vector<Result>::iterator e = results.begin(); e != results.end();)
+	{
+		if (e->game_id == game_id)
+		{
+			collected->push_back(*e);
+			e = results.erase(e);
+			found = true;
+		}
+		else
+			++e;
+	}
+	
+	return found;
+}
+
+void EquityWorker::run()
+{
+	unique_lock<std::mutex> lock(mutex);
+	
+	for (;;)
+	{
+		wakeup.wait(lock, [this] { return stop || !jobs.empty(); });
+		
+		if (stop)
+			break;
+		
+		Job job = jobs.front();
+		jobs.pop_front();
+		
+		running_game = job.game_id;
+		running_table = job.table_id;
+		running_cancelled = false;
+		
+		lock.unlock();
+		
+		Result r;
+		const bool ok = cache.calculate(job.request, &r.result);
+		
+		lock.lock();
+		
+		if (ok && !running_cancelled)
+		{
+			r.id = job.id;
+			r.game_id = job.game_id;
+			r.table_id = job.table_id;
+			r.betround = job.betround;
+			r.players.swap(job.players);
+			results.push_back(r);
+		}
+		
+		running_game = -1;
+		running_table = -1;
+	}
+}
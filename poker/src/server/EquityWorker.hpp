@@ -0,0 +1,103 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _EQUITYWORKER_H
+#define _EQUITYWORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "EquityEngine.hpp"
+#include "EquityCache.hpp"
+
+/*
+	Background thread computing all-in equity for the game controllers,
+	so the game loop never waits for it. Jobs are queued with submit()
+	and their results picked up later by the game loop with collect().
+	
+	A table has at most one pending job: submitting a newer one, e.g. on
+	the next street, replaces it, and the result of a job still running
+	is dropped.
+*/
+
+class EquityWorker
+{
+public:
+	typedef struct {
+		unsigned int id;         // set by submit()
+		int game_id;
+		int table_id;
+		int betround;
+		std::vector<int> players;  // client ids, in the order of the request
+		EquityRequest request;
+	} Job;
+	
+	typedef struct {
+		unsigned int id;
+		int game_id;
+		int table_id;
+		int betround;
+		std::vector<int> players;
+		EquityResult result;
+	} Result;
+	
+	explicit EquityWorker(unsigned int threads = 1);
+	~EquityWorker();
+	
+	// queue the job; returns its id
+	unsigned int submit(const Job &job);
+	
+	// drop pending jobs and results of a table, or of all tables of the game if table_id is -1
+	void cancel(int game_id, int table_id = -1);
+	
+	// move the finished results of a game to results
+	bool collect(int game_id, std::vector<Result> *results);
+	
+	void getCacheStats(EquityCache::Stats *stats) const { cache.getStats(stats); };
+	
+private:
+	void run();
+	void drop(int game_id, int table_id);  // with the mutex held
+	
+	EquityEngine engine;
+	EquityCache cache;  // all-in spots repeat, e.g. pairs against overcards
+	
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	unsigned int last_id;
+	
+	// the job being worked on
+	int running_game, running_table;
+	bool running_cancelled;
+	
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool stop;
+	
+	std::thread thread;
+};
+
+#endif /* _EQUITYWORKER_H */
@@ -38,8 +38,8 @@
 
 using namespace std;
 
-// temporary buffer for chat/snap data
-static char msg[1024];
+EquityWorker *GameController::equity_worker = NULL;
+DeckPool *GameController::deck_pool = NULL;
 
 
 GameController::GameController()
@@ -64,6 +64,9 @@ GameController::GameController()
 	
 	name = "game";
 	password = "";
+	
+	owner = -1;
+	publishRoster();
 }
 
 bool GameController::addPlayer(int cid, int buyIn)
@@ -94,7 +97,8 @@ bool GameController::addPlayer(int cid, int buyIn)
         Table *t = tables.begin()->second;
         chooseSeat(t, players[cid]);
     }
-
+	
+	publishRoster();
 	
 	return true;
 }
@@ -122,6 +126,8 @@ bool GameController::removePlayer(int cid)
 	if (bIsOwner)
 		selectNewOwner();
 	
+	publishRoster();
+	
 	return true;
 }
 
@@ -199,6 +205,23 @@ void GameController::selectNewOwner()
 	owner = e->second->client_id;
 }
 
+void GameController::publishRoster()
+{
+	lock_guard<std::mutex> lock(roster_mutex);
+	
+	roster.started = started;
+	roster.ended = ended;
+	roster.restart = restart;
+	roster.owner = owner;
+	getPlayerList(roster.players);
+}
+
+void GameController::getRoster(Roster *r) const
+{
+	lock_guard<std::mutex> lock(roster_mutex);
+	*r = roster;
+}
+
 void GameController::chat(int tid, const char* msg)
 {
 	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
@@ -258,42 +281,41 @@ bool GameController::setPlayerAction(int cid, Player::PlayerAction action, chips
 	return true;
 }
 
-bool GameController::createWinlist(Table *t, vector< vector<HandStrength> > &winlist)
+bool GameController::createWinlist(Table *t, WinList *winlist)
 {
-	vector<HandStrength> wl;
+	HandStrength wl[WinList::MaxHands];
+	unsigned int count = 0;
 	
 	unsigned int showdown_player = t->last_bet_player;
 	for (unsigned int i=0; i < t->countActivePlayers(); i++)
 	{
 		Player *p = t->seats[showdown_player].getPlayer();
 		
-		HandStrength strength;
-		GameLogic::getStrength(&(p->holecards), &(t->communitycards), &strength);
-		strength.setId(showdown_player);
-		
-		wl.push_back(strength);
+		GameLogic::getStrength(&(p->holecards), &(t->board), &wl[count]);
+		wl[count].setId(showdown_player);
+		count++;
 		
 		showdown_player = t->getNextActivePlayer(showdown_player);
 	}
 	
-	return GameLogic::getWinList(wl, winlist);
+	return GameLogic::getWinList(wl, count, winlist);
 }
 
 void GameController::sendTableSnapshot(Table *t)
 {
 	// assemble community-cards string
-	string scards;
-	vector<Card> cards;
+	char scards[3 * CommunityCards::Capacity];
+	char *sc = scards;
 	
-	t->communitycards.copyCards(&cards);
-	
-	for (unsigned int i=0; i < cards.size(); i++)
+	for (unsigned int i=0; i < t->communitycards.size(); i++)
 	{
-		scards += cards[i].getName();
+		if (i)
+			*sc++ = ':';
 		
-		if (i < cards.size() -1)
-			scards += ':';
+		memcpy(sc, t->communitycards[i].getName(), 2);
+		sc += 2;
 	}
+	*sc = '\0';
 	
 	
 	// assemble seats string
@@ -308,22 +330,15 @@ void GameController::sendTableSnapshot(Table *t)
 		Player *p = s->getPlayer();
 		
 		// assemble hole-cards string
-		string shole;
-		if (t->nomoreaction || s->showcards)
+		char shole[2 * HoleCards::Capacity + 1] = "-";
+		if ((t->nomoreaction || s->showcards) && p->holecards.size())
 		{
-			vector<Card> cards;
-		
-			p->holecards.copyCards(&cards);
-			
-			for (unsigned int i=0; i < cards.size(); i++)
-				shole += cards[i].getName();
-            if (cards.size() == 0) {
-                // could happen if player joins in the game late
-                shole = "-";
-            }
+			// no cards could happen if player joins in the game late
+			char *sh = shole;
+			for (const Card *c = p->holecards.begin(); c != p->holecards.end(); c++, sh += 2)
+				memcpy(sh, c->getName(), 2);
+			*sh = '\0';
 		}
-		else
-			shole = "-";
 		
 		int pstate = 0;
 		if (s->in_round)
@@ -340,7 +355,7 @@ void GameController::sendTableSnapshot(Table *t)
 			p->stake,
 			s->bet,
 			p->last_action,
-			shole.c_str());
+			shole);
 		
 		sseats += tmp;
 		
@@ -403,7 +418,7 @@ void GameController::sendTableSnapshot(Table *t)
 		"MinimumBet: %d",              // minimum bet
 		t->state, (t->state == Table::Betting) ? t->betround : -1,
 		sturn.c_str(),
-		scards.c_str(),
+		scards,
 		sseats.c_str(),
 		spots.c_str(),
 		minimum_bet);
@@ -413,21 +428,98 @@ void GameController::sendTableSnapshot(Table *t)
 
 void GameController::sendPlayerShowSnapshot(Table *t, Player *p)
 {
-	vector<Card> allcards;
-	p->holecards.copyCards(&allcards);
-	t->communitycards.copyCards(&allcards);
+	char hsstr[3 * (HoleCards::Capacity + CommunityCards::Capacity) + 1];
+	char *hs = hsstr;
 	
-	string hsstr;
-	for (vector<Card>::const_iterator e = allcards.begin(); e != allcards.end(); e++)
-		hsstr += string(e->getName()) + string(" ");
+	for (const Card *c = p->holecards.begin(); c != p->holecards.end(); c++, hs += 3)
+	{
+		memcpy(hs, c->getName(), 2);
+		hs[2] = ' ';
+	}
+	for (const Card *c = t->communitycards.begin(); c != t->communitycards.end(); c++, hs += 3)
+	{
+		memcpy(hs, c->getName(), 2);
+		hs[2] = ' ';
+	}
+	*hs = '\0';
 	
 	snprintf(msg, sizeof(msg), "%d %s",
 		p->client_id,
-		hsstr.c_str());
+		hsstr);
 	
 	snap(t->table_id, SnapPlayerShow, msg);
 }
 
+void GameController::requestEquity(Table *t)
+{
+	if (!equity_worker || !t->nomoreaction)
+		return;
+	
+	EquityWorker::Job job;
+	job.game_id = game_id;
+	job.table_id = t->table_id;
+	job.betround = t->betround;
+	
+	for (unsigned int i=0; i < 10; i++)
+	{
+		if (!t->seats[i].occupied || !t->seats[i].in_round)
+			continue;
+		
+		Player *p = t->seats[i].getPlayer();
+		
+		Card c1, c2;
+		if (!p->holecards.getCards(&c1, &c2))
+			continue;
+		
+		job.players.push_back(p->client_id);
+		job.request.holes.push_back(CardSet(c1) | CardSet(c2));
+	}
+	
+	if (job.players.size() < 2)
+		return;
+	
+	t->communitycards.copyCards(&job.request.board);
+	
+	// preflop: sample until +-0.5% at 95% confidence, at most 50000 trials;
+	// later streets have fewer runouts and are enumerated
+	job.request.trials = 50000;
+	job.request.tolerance = 0.005;
+	
+	// replaces the job of the last street, if still pending
+	t->equity_job = equity_worker->submit(job);
+}
+
+void GameController::publishEquity()
+{
+	vector<EquityWorker::Result> results;
+	if (!equity_worker || !equity_worker->collect(game_id, &results))
+		return;
+	
+	for (unsigned int i=0; i < results.size(); i++)
+	{
+		const EquityWorker::Result &r = results[i];
+		
+		// drop results of an earlier street or hand
+		tables_type::iterator e = tables.find(r.table_id);
+		if (e == tables.end() || e->second->equity_job != r.id)
+			continue;
+		
+		string sequity;
+		for (unsigned int j=0; j < r.players.size(); j++)
+		{
+			char tmp[32];
+			snprintf(tmp, sizeof(tmp), "%d:%d:%d ",
+				r.players[j],
+				(int)(r.result.players[j].equity * 10000 + 0.5),
+				(int)(r.result.players[j].tie * 10000 + 0.5));
+			sequity += tmp;
+		}
+		
+		snprintf(msg, sizeof(msg), "%d %s", r.betround, sequity.c_str());
+		snap(r.table_id, SnapPlayerEquity, msg);
+	}
+}
+
 chips_type GameController::determineMinimumBet(Table *t) const
 {
 	if (t->bet_amount == 0)
@@ -453,11 +545,8 @@ void GameController::dealHole(Table *t)
             t->deck.pop(c2);
             p->holecards.setCards(c1, c2);
             
-            char card1[3], card2[3];
-            strcpy(card1, c1.getName());
-            strcpy(card2, c2.getName());
             snprintf(msg, sizeof(msg), "%d %s %s",
-                     SnapCardsHole, card1, card2);
+                     SnapCardsHole, c1.getName(), c2.getName());
             snap(p->client_id, t->table_id, SnapCards, msg);
 
         //}
@@ -475,12 +564,13 @@ void GameController::dealFlop(Table *t)
 	t->deck.pop(f3);
 	t->communitycards.setFlop(f1, f2, f3);
 	
-	char card1[3], card2[3], card3[3];
-	strcpy(card1, f1.getName());
-	strcpy(card2, f2.getName());
-	strcpy(card3, f3.getName());
+	t->board.clear();
+	t->board.add(f1);
+	t->board.add(f2);
+	t->board.add(f3);
+	
 	snprintf(msg, sizeof(msg), "%d %s %s %s",
-		SnapCardsFlop, card1, card2, card3);
+		SnapCardsFlop, f1.getName(), f2.getName(), f3.getName());
 	snap(t->table_id, SnapCards, msg);
 }
 
@@ -489,11 +579,10 @@ void GameController::dealTurn(Table *t)
 	Card tc;
 	t->deck.pop(tc);
 	t->communitycards.setTurn(tc);
+	t->board.add(tc);
 	
-	char card[3];
-	strcpy(card, tc.getName());
 	snprintf(msg, sizeof(msg), "%d %s",
-		SnapCardsTurn, card);
+		SnapCardsTurn, tc.getName());
 	snap(t->table_id, SnapCards, msg);
 }
 
@@ -502,11 +591,10 @@ void GameController::dealRiver(Table *t)
 	Card r;
 	t->deck.pop(r);
 	t->communitycards.setRiver(r);
+	t->board.add(r);
 	
-	char card[3];
-	strcpy(card, r.getName());
 	snprintf(msg, sizeof(msg), "%d %s",
-		SnapCardsRiver, card);
+		SnapCardsRiver, r.getName());
 	snap(t->table_id, SnapCards, msg);
 }
 
@@ -524,9 +612,12 @@ void GameController::stateNewRound(Table *t)
 	
 
 #ifndef SERVER_TESTING
-	// fill and shuffle card-deck
-	t->deck.fill();
-	t->deck.shuffle();
+	// take a pre-shuffled card-deck; fill and shuffle if the pool ran dry
+	if (!deck_pool || !deck_pool->pop(&t->deck))
+	{
+		t->deck.fill();
+		t->deck.shuffle();
+	}
 #else
 	// set defined cards for testing
 	if (debug_cards.size())
@@ -538,14 +629,24 @@ void GameController::stateNewRound(Table *t)
 	else
 	{
 		dbg_msg("deck", "using random cards");
-		t->deck.fill();
-		t->deck.shuffle();
+		if (!deck_pool || !deck_pool->pop(&t->deck))
+		{
+			t->deck.fill();
+			t->deck.shuffle();
+		}
 	}
 #endif
 	
 	
 	// reset round-related
 	t->communitycards.clear();
+	t->board.clear();
+	
+	if (t->equity_job)
+	{
+		equity_worker->cancel(game_id, t->table_id);
+		t->equity_job = 0;
+	}
 	
 	t->bet_amount = 0;
 	t->last_bet_amount = 0;
@@ -770,6 +871,8 @@ void GameController::stateBlinds(Table *t)
 	t->scheduleState(Table::Betting, 3);
 	
 	sendTableSnapshot(t);
+	
+	requestEquity(t);
 }
 
 void GameController::stateBetting(Table *t)
@@ -986,10 +1089,21 @@ void GameController::stateBetting(Table *t)
 		
 		
 		// all (or all except one) players are allin
-		if (t->isAllin())
+		if (t->isAllin() && !t->nomoreaction)
 		{
 			// no further action at table possible
 			t->nomoreaction = true;
+			
+			// equity of this street first; the next one is dealt on a later tick,
+			// as its job would replace this one
+			if (t->betround != Table::River)
+			{
+				sendTableSnapshot(t);
+				requestEquity(t);
+				
+				t->scheduleState(Table::Betting, 2);
+				return;
+			}
 		}
 		
 		
@@ -1038,6 +1152,9 @@ void GameController::stateBetting(Table *t)
 		t->cur_player = -1;	// invalidate current player
 		sendTableSnapshot(t);
 		
+		// all-in: equity for the new street
+		requestEquity(t);
+		
 		
 		// reset the highest bet-amount
 		t->bet_amount = 0;
@@ -1243,66 +1360,64 @@ void GameController::stateShowdown(Table *t)
 	
 	
 	// determine winners
-	vector< vector<HandStrength> > winlist;
-	createWinlist(t, winlist);
+	WinList winlist;
+	createWinlist(t, &winlist);
 	
-	// for each winner-list
-	for (unsigned int i=0; i < winlist.size(); i++)
+	// for each winner-group, strongest first
+	for (unsigned int i=0; i < winlist.getGroupCount(); i++)
 	{
-		vector<HandStrength> &tw = winlist[i];
-		const unsigned int winner_count = tw.size();
+		const unsigned int winner_count = winlist.getGroupSize(i);
 		
-		// for each pot
+		unsigned int winner_seats = 0;
+		for (unsigned int pi=0; pi < winner_count; pi++)
+			winner_seats |= 1 << winlist.get(i, pi).getId();
+		
+		// for each pot; pots are emptied by the first group involved in them
 		for (unsigned int poti=0; poti < t->pots.size(); poti++)
 		{
 			Table::Pot *pot = &(t->pots[poti]);
-			const unsigned int involved_count = t->getInvolvedInPotCount(pot, tw);
 			
+			if (!pot->amount)
+				continue;
 			
-			chips_type win_amount = 0;
-			chips_type odd_chips = 0;
+			const unsigned int pot_seats = t->getPotSeatMask(pot);
+			const unsigned int involved_count = CardSet::popcount(pot_seats & winner_seats);
 			
-			if (involved_count)
-			{
-				// pot is divided by number of players involved in
-				win_amount = pot->amount / involved_count;
-				
-				// odd chips
-				odd_chips = pot->amount - (win_amount * involved_count);
-			}
+			if (!involved_count)
+				continue;
+			
+			// pot is divided by number of players involved in
+			const chips_type win_amount = pot->amount / involved_count;
+			
+			// odd chips
+			const chips_type odd_chips = pot->amount - (win_amount * involved_count);
 			
 			
 			chips_type cashout_amount = 0;
 			
 			// for each winning-player
-			for (unsigned int pi=0; pi < winner_count; pi++)
+			for (unsigned int pi=0; pi < winner_count && win_amount > 0; pi++)
 			{
-				const unsigned int seat_num = tw[pi].getId();
-				Seat *seat = &(t->seats[seat_num]);
-				Player *p = seat->getPlayer();
+				const unsigned int seat_num = winlist.get(i, pi).getId();
 				
 				// skip pot if player not involved in it
-				if (!t->isSeatInvolvedInPot(pot, seat_num))
+				if (!(pot_seats & (1 << seat_num)))
 					continue;
-#if 0
-				dbg_msg("winlist", "wl #%d involved-count=%d player #%d (seat:%d) pot #%d ($%d) ",
-					i+1, involved_count, pi, seat_num, poti, pot->amount);
-#endif
 				
-				if (win_amount > 0)
-				{
-					// transfer winning amount to player
-					p->stake += win_amount;
-					
-					// put winnings to seat (needed for snapshot)
-					seat->bet += win_amount;
-					
-					// count up overall cashed-out
-					cashout_amount += win_amount;
-					
-					snprintf(msg, sizeof(msg), "%d %d %d", p->client_id, poti, win_amount);
-					snap(t->table_id, SnapWinPot, msg);
-				}
+				Seat *seat = &(t->seats[seat_num]);
+				Player *p = seat->getPlayer();
+				
+				// transfer winning amount to player
+				p->stake += win_amount;
+				
+				// put winnings to seat (needed for snapshot)
+				seat->bet += win_amount;
+				
+				// count up overall cashed-out
+				cashout_amount += win_amount;
+				
+				snprintf(msg, sizeof(msg), "%d %d %d", p->client_id, poti, win_amount);
+				snap(t->table_id, SnapWinPot, msg);
 			}
 			
 			// distribute odd chips
@@ -1311,7 +1426,7 @@ void GameController::stateShowdown(Table *t)
 				// find the next player behind button which is involved in pot
 				unsigned int oddchips_player = t->getNextActivePlayer(t->dealer);
 				
-				while (!t->isSeatInvolvedInPot(pot, oddchips_player))
+				while (!(pot_seats & (1 << oddchips_player)))
 					oddchips_player = t->getNextActivePlayer(oddchips_player);
 				
 				
@@ -1557,6 +1672,8 @@ void GameController::start()
 	sendTableSnapshot(t);
 	
 	t->scheduleState(Table::NewRound, 5);
+	
+	publishRoster();
 }
 
 void GameController::chooseSeat(Table *t, shared_ptr<Player> p) {
@@ -1582,6 +1699,9 @@ void GameController::chooseSeat(Table *t, shared_ptr<Player> p) {
 
 int GameController::tick()
 {
+	// changes of the last tick, e.g. players who left
+	publishRoster();
+	
 	if (!started)
 	{
 		if (getPlayerCount() == 2)  // start game if player count reached
@@ -1600,12 +1720,18 @@ int GameController::tick()
 			for (players_type::iterator e = players.begin(); e != players.end();)
 				players.erase(e++);
 			
+			if (equity_worker)
+				equity_worker->cancel(game_id);
+			
 			return -1;
 		}
 		else
 			return 0;
 	}
 	
+	// equity results finished since the last tick
+	publishEquity();
+	
 	// handle all tables
 	for (tables_type::iterator e = tables.begin(); e != tables.end();)
 	{
@@ -1624,6 +1750,9 @@ int GameController::tick()
 				snap(-1, SnapGameState, msg);
 			}
 			
+			if (equity_worker)
+				equity_worker->cancel(game_id, t->table_id);
+			
 			delete t;
 			tables.erase(e++);
 		}
@@ -28,6 +28,7 @@
 #include <map>
 #include <string>
 #include <ctime>
+#include <mutex>
 
 #include "Card.hpp"
 #include "Deck.hpp"
@@ -36,13 +37,30 @@
 #include "Table.hpp"
 #include "Player.hpp"
 #include "GameLogic.hpp"
+#include "EquityWorker.hpp"
+#include "DeckPool.hpp"
 
 
+/*
+	A game is driven by a single thread at a time (its strand, see game.cpp).
+	Other threads only read the settings, which are fixed once the game is
+	listed, and the roster the game publishes.
+*/
+
 class GameController
 {
 friend class TestCaseGameController;
 
 public:
+	// lobby view of the players and the game state
+	typedef struct {
+		bool started;
+		bool ended;
+		bool restart;
+		int owner;
+		std::vector<int> players;  // client ids
+	} Roster;
+	
 	typedef std::map<int,Table*>	tables_type;
 	typedef std::map<int, std::shared_ptr<Player>>	players_type;
 	
@@ -102,7 +120,7 @@ public:
 	unsigned int getPlayerCount() const { return players.size(); };
 	bool getPlayerList(std::vector<int> &client_list) const;
 	
-	void setRestart(bool bRestart) { restart = bRestart; };
+	void setRestart(bool bRestart) { restart = bRestart; publishRoster(); };
 	bool getRestart() const { return restart; };
 	
 	bool isStarted() const { return started; };
@@ -112,9 +130,12 @@ public:
 	bool removePlayer(int cid);
 	bool isPlayer(int cid) const;
 	
-	void setOwner(int cid) { owner = cid; };
+	void setOwner(int cid) { owner = cid; publishRoster(); };
 	int getOwner() const { return owner; };
 	
+	// safe from any thread; at most one tick old
+	void getRoster(Roster *r) const;
+	
 	void chat(int tid, const char* msg);
 	void chat(int cid, int tid, const char* msg);
 	
@@ -124,15 +145,22 @@ public:
 	
 	int tick();
 	
+	// worker for all-in equity snapshots; none disables them
+	static void setEquityWorker(EquityWorker *worker) { equity_worker = worker; };
+	
+	// source of pre-shuffled decks; none shuffles inline
+	static void setDeckPool(DeckPool *pool) { deck_pool = pool; };
+	
 	
 protected:
 	Player* findPlayer(int cid);
 	void selectNewOwner();
+	void publishRoster();
 	
 	void snap(int tid, int sid, const char* msg="");
 	void snap(int cid, int tid, int sid, const char* msg="");
 	
-	bool createWinlist(Table *t, std::vector< std::vector<HandStrength> > &winlist);
+	bool createWinlist(Table *t, WinList *winlist);
 	chips_type determineMinimumBet(Table *t) const;
 	
 	int handleTable(Table *t);
@@ -155,6 +183,9 @@ protected:
 	
 	void sendTableSnapshot(Table *t);
 	void sendPlayerShowSnapshot(Table *t, Player *p);
+	
+	void requestEquity(Table *t);
+	void publishEquity();
     
     bool isAllowedAction(Table *t, Player::PlayerAction action);
     void chooseSeat(Table *t, std::shared_ptr<Player> p);
@@ -195,6 +226,15 @@ private:
 	std::string name;
 	std::string password;
 	
+	Roster roster;
+	mutable std::mutex roster_mutex;
+	
+	// temporary buffer for chat/snap data
+	char msg[1024];
+	
+	static EquityWorker *equity_worker;
+	static DeckPool *deck_pool;
+	
 #ifdef DEBUG
 	std::vector<Card> debug_cards;
 #endif
@@ -31,8 +31,10 @@ using namespace std;
 
 
 Table::Table()
+	: deck(rng)
 {
 	table_id = -1;
+	equity_job = 0;
 }
 
 int Table::getNextPlayer(unsigned int pos)
@@ -139,22 +141,15 @@ bool Table::isSeatInvolvedInPot(Pot *pot, unsigned int s)
 	return false;
 }
 
-unsigned int Table::getInvolvedInPotCount(Pot *pot, std::vector<HandStrength> &wl)
+// bit n is set if seat n is involved in pot
+unsigned int Table::getPotSeatMask(const Pot *pot)
 {
-	unsigned int involved_count = 0;
+	unsigned int mask = 0;
 	
 	for (unsigned int i=0; i < pot->vseats.size(); i++)
-	{
-		const unsigned int s = pot->vseats[i];
-		
-		for (unsigned int j=0; j < wl.size(); j++)
-		{
-			if ((unsigned int) wl[j].getId() == s)
-				involved_count++;
-		}
-	}
+		mask |= 1 << pot->vseats[i];
 	
-	return involved_count;
+	return mask;
 }
 
 void Table::collectBets()
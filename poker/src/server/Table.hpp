@@ -62,6 +62,7 @@ class Table
 {
 friend class GameController;
 friend class TestCaseGameController;
+friend class TableBench;
 
 public:
 	typedef enum {
@@ -107,7 +108,7 @@ public:
 	
 	void collectBets();
 	bool isSeatInvolvedInPot(Pot *pot, unsigned int s);
-	unsigned int getInvolvedInPotCount(Pot *pot, std::vector<HandStrength> &wl);
+	unsigned int getPotSeatMask(const Pot *pot);
 	
 	void scheduleState(State sched_state, unsigned int delay_sec);
 	
@@ -116,8 +117,10 @@ public:
 private:
 	int table_id;
 	
+	ChaCha20 rng;  // seeded from the OS per table
 	Deck deck;
 	CommunityCards communitycards;
+	BoardContext board;  // pre-evaluated communitycards
 	
 	State state;
 	
@@ -131,6 +134,8 @@ private:
 	bool nomoreaction;
 	BettingRound betround;
 	
+	unsigned int equity_job;  // pending all-in equity job, 0 if none
+	
 	Seat seats[10];
 	int dealer, sb, bb;
 	int cur_player;
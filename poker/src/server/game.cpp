@@ -24,6 +24,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <functional>
+#include <mutex>
 
 #include "Config.h"
 #include "Platform.h"
@@ -41,9 +44,17 @@ using namespace std;
 
 extern ConfigParser config;
 
-// temporary buffer for sending messages
+// size of temporary buffers for sending messages
 #define MSG_BUFFER_SIZE  (1024*16)
-static char msg[MSG_BUFFER_SIZE];
+
+/*
+	Threading: the lobby state below (games, clients, con_archive) is only
+	touched on the lobby strand. Each game runs on its own strand, and only
+	the lobby strand posts to it. Games reach their clients through the
+	route table, the one piece of lobby state guarded by a mutex.
+*/
+static boost::asio::io_service *io = NULL;
+static boost::asio::io_service::strand *lobby = NULL;
 
 static games_type games;
 static unsigned int gid_counter = 0;
@@ -55,16 +66,64 @@ static unsigned int cid_counter = 0;
 static clientconar_type con_archive;
 static time_t last_conarchive_cleanup = 0;   // last time scan
 
+typedef struct {
+	socktype sock;
+	Dispatcher *dispatcher;
+} clientroute;
+
+static std::map<int,clientroute> routes;  // introduced clients by id
+static std::mutex routes_mutex;
+
+static EquityWorker *equity_worker = NULL;
+static DeckPool *deck_pool = NULL;
+
 
+void game_init(boost::asio::io_service &io_service)
+{
+	io = &io_service;
+	lobby = new boost::asio::io_service::strand(io_service);
+}
+
+boost::asio::io_service::strand& lobby_strand()
+{
+	return *lobby;
+}
+
+// lobby-side lookup; only the settings of a game may be read directly, see GameController.hpp
 GameController* get_game_by_id(int gid)
 {
 	games_type::const_iterator it = games.find(gid);
 	if (it != games.end())
-		return it->second;
+		return it->second.game;
 	else
 		return NULL;
 }
 
+static void add_game(int gid, GameController *g)
+{
+	gameentry &entry = games[gid];
+	entry.game = g;
+	entry.strand = std::make_shared<boost::asio::io_service::strand>(*io);
+}
+
+// run f on the strand of the game
+static bool game_post(int gid, const std::function<void(GameController*)> &f)
+{
+	games_type::const_iterator it = games.find(gid);
+	if (it == games.end())
+		return false;
+	
+	GameController *g = it->second.game;
+	it->second.strand->post([g, f]() { f(g); });
+	
+	return true;
+}
+
+static bool is_player(const GameController::Roster &roster, int cid)
+{
+	return find(roster.players.begin(), roster.players.end(), cid) != roster.players.end();
+}
+
 // for pserver.cpp filling FD_SET
 clients_type& get_client_vector()
 {
@@ -89,37 +148,80 @@ clientcon* get_client_by_id(int cid)
 	return NULL;
 }
 
-int send_msg(socktype sock, const char *message)
+// safe from any thread
+static int send_route(const clientroute &route, const char *message)
 {
-    clientcon *conn = get_client_by_sock(sock);
-    
     char buf[MSG_BUFFER_SIZE];
 	const int len = snprintf(buf, sizeof(buf), "%s\r\n", message);
     string out(buf);
     
-	const int bytes = conn->dispatcher->dispatch(sock, out);
+	const int bytes = route.dispatcher->dispatch(route.sock, out);
 
 	
 	// FIXME: send remaining bytes if not all have been sent
 	if (len != bytes)
-		log_msg("clientsock", "(%d) warning: not all bytes written (%d != %d)", sock, len, bytes);
+		log_msg("clientsock", "(%d) warning: not all bytes written (%d != %d)", route.sock, len, bytes);
 	
 	return bytes;
 }
 
-bool send_response(socktype sock, bool is_success, int last_msgid, int code=0, const char *str="")
+// to an introduced client; safe from any thread
+static int send_to(int cid, const char *message)
+{
+	clientroute route;
+	{
+		lock_guard<std::mutex> lock(routes_mutex);
+		
+		map<int,clientroute>::const_iterator it = routes.find(cid);
+		if (it == routes.end())
+			return 0;
+		
+		route = it->second;
+	}
+	
+	return send_route(route, message);
+}
+
+int send_msg(socktype sock, const char *message)
+{
+    clientcon *conn = get_client_by_sock(sock);
+    if (!conn)
+        return 0;
+    
+    clientroute route;
+    route.sock = sock;
+    route.dispatcher = conn->dispatcher;
+    
+	return send_route(route, message);
+}
+
+static void format_response(char *buf, size_t size, bool is_success, int last_msgid, int code, const char *str)
 {
-	char buf[512];
 	if (last_msgid == -1)
-		snprintf(buf, sizeof(buf), "%s %d %s",
+		snprintf(buf, size, "%s %d %s",
 			is_success ? "OK" : "ERR", code, str);
 	else
-		snprintf(buf, sizeof(buf), "%d %s %d %s",
+		snprintf(buf, size, "%d %s %d %s",
 			  last_msgid, is_success ? "OK" : "ERR", code, str);
+}
+
+bool send_response(socktype sock, bool is_success, int last_msgid, int code=0, const char *str="")
+{
+	char buf[512];
+	format_response(buf, sizeof(buf), is_success, last_msgid, code, str);
 	
 	return send_msg(sock, buf);
 }
 
+// response to a command finished on a game strand
+static bool send_game_response(int cid, bool is_success, int last_msgid, int code=0, const char *str="")
+{
+	char buf[512];
+	format_response(buf, sizeof(buf), is_success, last_msgid, code, str);
+	
+	return send_to(cid, buf);
+}
+
 bool send_game_join_ok(clientcon *client, int code=0, const char *str="") {
     return send_response(client->sock, true, client->last_msgid, code, str);
 }
@@ -188,9 +290,7 @@ bool client_chat(int from_gid, int from_tid, int to, const char *message)
 	snprintf(msg, sizeof(msg), "GAMEMSG Game:%d Table:%d Type:%s Message:%s",
 		from_gid, from_tid, (from_tid == -1) ? "game" : "table", message);
 	
-	clientcon* toclient = get_client_by_id(to);
-	if (toclient)
-		send_msg(toclient->sock, msg);
+	send_to(to, msg);
 	
 	return true;
 }
@@ -206,8 +306,9 @@ bool table_chat(int from_cid, int to_gid, int to_tid, const char *message)
 	if (!g)
 		return false;
 	
-	vector<int> client_list;
-	g->getPlayerList(client_list);
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	const vector<int> &client_list = roster.players;
 	
 	for (unsigned int i=0; i < client_list.size(); i++)
 	{
@@ -230,9 +331,7 @@ bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *me
 	snprintf(buf, sizeof(buf), "SNAP Game:%d Table:%d Type:%d %s",
 		from_gid, from_tid, sid, message);
 	
-	clientcon* toclient = get_client_by_id(to);
-	if (toclient && toclient->state & Introduced)
-		send_msg(toclient->sock, buf);
+	send_to(to, buf);
 	
 	return true;
 }
@@ -309,15 +408,19 @@ bool client_remove(socktype sock)
 		{
 			//socket_close(client->sock);
 			
+			char msg[MSG_BUFFER_SIZE];
 			bool send_msg = false;
 			if (client->state & SentInfo)
 			{
 				// remove player from unstarted games
+				const int cid = client->id;
 				for (games_type::iterator e = games.begin(); e != games.end(); e++)
 				{
-					GameController *g = e->second;
-					if (!g->isStarted() && g->isPlayer(client->id))
-						g->removePlayer(client->id);
+					GameController::Roster roster;
+					e->second.game->getRoster(&roster);
+					
+					if (!roster.started && is_player(roster, cid))
+						game_post(e->first, [cid](GameController *g) { g->removePlayer(cid); });
 				}
 				
 				
@@ -339,6 +442,12 @@ bool client_remove(socktype sock)
 			
 			log_msg("clientsock", "(%d) connection closed", client->sock);
 			
+			if (client->state & Introduced)
+			{
+				lock_guard<std::mutex> lock(routes_mutex);
+				routes.erase(client->id);
+			}
+			
 			clients.erase(client);
 			
 			// send foyer snapshot to all remaining clients
@@ -405,12 +514,21 @@ int client_cmd_pclient(clientcon *client, Tokenizer &t)
 		if (!use_prev_cid)
 			client->id = cid_counter++;
 		
+		// reachable from the games
+		{
+			lock_guard<std::mutex> lock(routes_mutex);
+			clientroute &route = routes[client->id];
+			route.sock = client->sock;
+			route.dispatcher = client->dispatcher;
+		}
+		
 		
 		// set initial client info
 		snprintf(client->info.name, sizeof(client->info.name), "client_%d", client->id);
 		*(client->info.location) = '\0';
 		
 		// send 'introduced response'
+		char msg[256];
 		snprintf(msg, sizeof(msg), "PSERVER Version: %d ClientId: %d Time: %d",
 			VERSION,
 			client->id,
@@ -450,6 +568,8 @@ int client_cmd_info(clientcon *client, Tokenizer &t)
 	
 	if (!(client->state & SentInfo))
 	{
+		char msg[MSG_BUFFER_SIZE];
+		
 		// store UUID in connection-archive
 		if (*client->uuid)
 		{
@@ -560,6 +680,9 @@ bool send_gameinfo(clientcon *client, int gid)
 	if (!(g = get_game_by_id(gid)))
 		return false;
 	
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	
 	int game_mode = 0;
 	switch ((int)g->getGameType())
 	{
@@ -575,13 +698,14 @@ bool send_gameinfo(clientcon *client, int gid)
 	}
 	
 	int state = 0;
-	if (g->isEnded())
+	if (roster.ended)
 		state = GameStateEnded;
-	else if (g->isStarted())
+	else if (roster.started)
 		state = GameStateStarted;
 	else
 		state = GameStateWaiting;
 	
+	char msg[MSG_BUFFER_SIZE];
 	snprintf(msg, sizeof(msg),
 		"GAMEINFO Game Id:%d Game State:%d Type:%d Mode:%d Flags:%d PlayerMax:%d PlayerCount:%d PlayerTimeout:%d PlayerStakes:%d MaxBuyIn:%d BlindsStart:%d BindsFactor:%d BlindsTime:%d Name:\"%s\"",
 		gid,
@@ -589,12 +713,12 @@ bool send_gameinfo(clientcon *client, int gid)
 		(int) GameTypeHoldem,
 		game_mode,
 
-		(g->isPlayer(client->id) ? GameInfoRegistered : 0) |
+		(is_player(roster, client->id) ? GameInfoRegistered : 0) |
 			(g->hasPassword() ? GameInfoPassword : 0) |
-			(g->getOwner() == client->id ? GameInfoOwner : 0) |
-			(g->getRestart() ? GameInfoRestart : 0),
+			(roster.owner == client->id ? GameInfoOwner : 0) |
+			(roster.restart ? GameInfoRestart : 0),
 		g->getPlayerMax(),
-		g->getPlayerCount(),
+		(int) roster.players.size(),
 		g->getPlayerTimeout(),
 		g->getPlayerStakes(),
         g->getMaxBuyIn(),
@@ -629,6 +753,7 @@ bool client_cmd_request_clientinfo(clientcon *client, Tokenizer &t)
 		const clientcon *c;
 		if ((c = get_client_by_id(cid)))
 		{
+			char msg[256];
 			snprintf(msg, sizeof(msg),
 				"CLIENTINFO %d \"name:%s\" \"location:%s\"",
 				cid,
@@ -643,6 +768,7 @@ bool client_cmd_request_clientinfo(clientcon *client, Tokenizer &t)
 
 bool client_cmd_request_gamelist(clientcon *client, Tokenizer &t)
 {
+	char msg[MSG_BUFFER_SIZE];
 	string gamelist;
 	for (games_type::iterator e = games.begin(); e != games.end(); e++)
 	{
@@ -669,9 +795,11 @@ bool client_cmd_request_playerlist(clientcon *client, Tokenizer &t)
 	if (!g)
 		return false;
 	
-	vector<int> client_list;
-	g->getPlayerList(client_list);
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	const vector<int> &client_list = roster.players;
 	
+	char msg[MSG_BUFFER_SIZE];
 	string slist;
 	for (unsigned int i=0; i < client_list.size(); i++)
 	{
@@ -687,6 +815,7 @@ bool client_cmd_request_playerlist(clientcon *client, Tokenizer &t)
 
 bool client_cmd_request_serverinfo(clientcon *client, Tokenizer &t)
 {
+	char msg[256];
 	snprintf(msg, sizeof(msg), "SERVERINFO %d:%d:%d",
 		(int) clients.size(),
 		(int) con_archive.size(),
@@ -706,10 +835,13 @@ bool client_cmd_request_gamestart(clientcon *client, Tokenizer &t)
 	if (!g)
 		return false;
 	
-	if (g->getOwner() != client->id && !(client->state & Authed))
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	
+	if (roster.owner != client->id && !(client->state & Authed))
 		return false;
 	
-	g->start();
+	game_post(gid, [](GameController *g) { g->start(); });
 	
 	return true;
 }
@@ -719,14 +851,13 @@ bool client_cmd_request_gamerestart(clientcon *client, Tokenizer &t)
 	int gid, restart;
 	t >> gid >> restart;
 
-	GameController *g = get_game_by_id(gid);
-	if (!g)
+	if (!get_game_by_id(gid))
 		return false;
 
 	if (!(client->state & Authed))
 		return false;
 
-	g->setRestart(restart);
+	game_post(gid, [restart](GameController *g) { g->setRestart(restart); });
 
 	return true;
 }
@@ -797,8 +928,11 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	
     if (/* DISABLES CODE for cash game */ (0)) {
-        if (g->isStarted())
+        if (roster.started)
         {
             send_err(client, 0 /*FIXME*/, "game has already been started");
             return 1;
@@ -806,7 +940,7 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
     }
 	
 	
-	if (g->isPlayer(client->id))
+	if (is_player(roster, client->id))
 	{
 		send_err(client, 0 /*FIXME*/, "you are already registered");
 		return 1;
@@ -817,9 +951,9 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 	unsigned int count = 0;
 	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
 	{
-		GameController *g = e->second;
+		e->second.game->getRoster(&roster);
 		
-		if (g->isPlayer(client->id))
+		if (is_player(roster, client->id))
 		{
 			if (++count == register_limit)
 			{
@@ -836,18 +970,23 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
-	if (!g->addPlayer(client->id, buyIn))
-	{
-		send_err(client, 0 /*FIXME*/, "unable to register");
-		return 1;
-	}
+	// the game has the last word; answer from its strand
+	const int cid = client->id, msgid = client->last_msgid;
+	const string name = client->info.name;
 	
-	
-	log_msg("game", "%s (%d) joined game %d (%d/%d)",
-		client->info.name, client->id, gid,
-		g->getPlayerCount(), g->getPlayerMax());
-	
-    send_game_join_ok(client);
+	game_post(gid, [cid, msgid, name, gid, buyIn](GameController *g) {
+		if (!g->addPlayer(cid, buyIn))
+		{
+			send_game_response(cid, false, msgid, 0 /*FIXME*/, "unable to register");
+			return;
+		}
+		
+		log_msg("game", "%s (%d) joined game %d (%d/%d)",
+			name.c_str(), cid, gid,
+			g->getPlayerCount(), g->getPlayerMax());
+		
+		send_game_response(cid, true, msgid);
+	});
 	
 	return 0;
 }
@@ -870,31 +1009,38 @@ int client_cmd_unregister(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
-	if (g->isStarted())
+	GameController::Roster roster;
+	g->getRoster(&roster);
+	
+	if (roster.started)
 	{
 		send_err(client, 0 /*FIXME*/, "game has already been started");
 		return 1;
 	}
 	
-	if (!g->isPlayer(client->id))
+	if (!is_player(roster, client->id))
 	{
 		send_err(client, 0 /*FIXME*/, "you are not registered");
 		return 1;
 	}
 	
-	if (!g->removePlayer(client->id))
-	{
-		send_err(client, 0 /*FIXME*/, "unable to unregister");
-		return 1;
-	}
-	
+	// the roster may be a tick old; answer from the game's strand
+	const int cid = client->id, msgid = client->last_msgid;
+	const string name = client->info.name;
 	
-	log_msg("game", "%s (%d) parted game %d (%d/%d)",
-		client->info.name, client->id, gid,
-		g->getPlayerCount(), g->getPlayerMax());
-	
-	
-	send_ok(client);
+	game_post(gid, [cid, msgid, name, gid](GameController *g) {
+		if (!g->removePlayer(cid))
+		{
+			send_game_response(cid, false, msgid, 0 /*FIXME*/, "unable to unregister");
+			return;
+		}
+		
+		log_msg("game", "%s (%d) parted game %d (%d/%d)",
+			name.c_str(), cid, gid,
+			g->getPlayerCount(), g->getPlayerMax());
+		
+		send_game_response(cid, true, msgid);
+	});
 	
 	return 0;
 }
@@ -954,7 +1100,8 @@ int client_cmd_action(clientcon *client, Tokenizer &t)
 	}
 	
 	
-	g->setPlayerAction(client->id, a, amount);
+	const int cid = client->id;
+	game_post(gid, [cid, a, amount](GameController *g) { g->setPlayerAction(cid, a, amount); });
 	
 	send_ok(client);
 	
@@ -983,9 +1130,10 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 	unsigned int count = 0;
 	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
 	{
-		GameController *g = e->second;
+		GameController::Roster roster;
+		e->second.game->getRoster(&roster);
 		
-		if (g->getOwner() == client->id)
+		if (roster.owner == client->id)
 		{
 			if (++count == create_limit)
 			{
@@ -1149,7 +1297,7 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		g->setBlindsTime(ginfo.blinds_time);
 		g->setPassword(ginfo.password);
 		g->setRestart(ginfo.restart);
-		games[gid] = g;
+		add_game(gid, g);
 		
 		send_ok(client);
 		
@@ -1213,6 +1361,7 @@ int client_cmd_config(clientcon *client, Tokenizer &t)
 	
 	if (client->state & Authed)
 	{
+		char msg[MSG_BUFFER_SIZE];
 		const string action = t.getNext();
 		const string varname = t.getNext();
 		
@@ -1364,7 +1513,7 @@ int client_parsebuffer(clientcon *client)
 	return retval;
 }
 
-int client_handle(socktype sock, char buf[1024], std::size_t bytes)
+int client_handle(socktype sock, const char *buf, std::size_t bytes)
 {
 	
 	clientcon *client = get_client_by_sock(sock);
@@ -1414,8 +1563,59 @@ void remove_expired_conar_entries()
 	}
 }
 
+// on the lobby strand; called for every tick after the end of the game
+static void game_ended(int gid, bool restart, int owner)
+{
+	games_type::iterator it = games.find(gid);
+	if (it == games.end())
+		return;
+	
+	GameController *g = it->second.game;
+	
+	// replicate game if "restart" is set  // FIXME: implement copy-constructor
+	if (restart)
+	{
+		const int gid = ++gid_counter;
+		GameController *newgame = new GameController();
+		
+		newgame->setGameId(gid);
+		newgame->setName(g->getName());
+		newgame->setRestart(true);
+		newgame->setOwner(owner);
+		newgame->setPlayerMax(g->getPlayerMax());
+		newgame->setPlayerTimeout(g->getPlayerTimeout());
+		newgame->setPlayerStakes(g->getPlayerStakes());
+        newgame->setMaxBuyIn(g->getMaxBuyIn())  ;
+		add_game(gid, newgame);
+		
+		log_msg("game", "restarted game (old: %d, new: %d)",
+			g->getGameId(), newgame->getGameId());
+	}
+	else
+		log_msg("game", "deleting game %d", g->getGameId());
+	
+	// nothing is posted to the game after this; queued handlers run first
+	std::shared_ptr<boost::asio::io_service::strand> strand = it->second.strand;
+	games.erase(it);
+	strand->post([g, strand]() { delete g; });
+}
+
 int gameloop()
 {
+	// start the all-in equity worker once
+	if (!equity_worker && config.getBool("equity_snapshots"))
+	{
+		equity_worker = new EquityWorker(config.getInt("equity_threads"));
+		GameController::setEquityWorker(equity_worker);
+	}
+	
+	// start the deck shuffler once
+	if (!deck_pool && config.getInt("deck_pool") > 0)
+	{
+		deck_pool = new DeckPool(config.getInt("deck_pool"));
+		GameController::setDeckPool(deck_pool);
+	}
+	
 #ifdef DEBUG
 	// initially add games for debugging purpose
 	if (!games.size())
@@ -1439,7 +1639,7 @@ int gameloop()
 					g->addPlayer(j*1000 + i, 1500);
 			}
 			
-			games[gid] = g;
+			add_game(gid, g);
 			
 			gid_counter++;
 		}
@@ -1447,39 +1647,19 @@ int gameloop()
 #endif
 	
 	
-	// handle all games
-	for (games_type::iterator e = games.begin(); e != games.end();)
+	// handle all games, each on its own strand; ended games report back
+	for (games_type::iterator e = games.begin(); e != games.end(); e++)
 	{
-		GameController *g = e->second;
-		if (g->tick() < 0)
-		{
-			// replicate game if "restart" is set  // FIXME: implement copy-constructor
-			if (g->getRestart())
+		const int gid = e->first;
+		
+		game_post(gid, [gid](GameController *g) {
+			if (g->tick() < 0)
 			{
-				const int gid = ++gid_counter;
-				GameController *newgame = new GameController();
-				
-				newgame->setGameId(gid);
-				newgame->setName(g->getName());
-				newgame->setRestart(true);
-				newgame->setOwner(g->getOwner());
-				newgame->setPlayerMax(g->getPlayerMax());
-				newgame->setPlayerTimeout(g->getPlayerTimeout());
-				newgame->setPlayerStakes(g->getPlayerStakes());
-                newgame->setMaxBuyIn(g->getMaxBuyIn())  ;
-				games[gid] = newgame;
-				
-				log_msg("game", "restarted game (old: %d, new: %d)",
-					g->getGameId(), newgame->getGameId());
+				const bool restart = g->getRestart();
+				const int owner = g->getOwner();
+				lobby->post([gid, restart, owner]() { game_ended(gid, restart, owner); });
 			}
-			else
-				log_msg("game", "deleting game %d", g->getGameId());
-			
-			delete g;
-			games.erase(e++);
-		}
-		else
-			++e;
+		});
 	}
 	
 	
@@ -28,6 +28,10 @@
 #include <map>
 #include <string>
 #include <ctime>
+#include <memory>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
 
 #include "Config.h"
 #include "Platform.h"
@@ -110,8 +114,14 @@ typedef struct {
 	time_t logout_time;
 } clientcon_archive;
 
+//! \brief A game and the strand it runs on
+typedef struct {
+	GameController *game;
+	std::shared_ptr<boost::asio::io_service::strand> strand;
+} gameentry;
+
 //! \brief Type for list of games
-typedef std::map<int,GameController*>	games_type;
+typedef std::map<int,gameentry>	games_type;
 
 //! \brief Type for list of client connection information
 typedef std::vector<clientcon>	clients_type;
@@ -120,14 +130,16 @@ typedef std::vector<clientcon>	clients_type;
 typedef std::map<std::string,clientcon_archive>	clientconar_type;
 
 
-// used by pserver.cpp
+// used by pserver.cpp; all but game_init() on the lobby strand
+void game_init(boost::asio::io_service &io_service);
+boost::asio::io_service::strand& lobby_strand();
 int gameloop();
 clients_type& get_client_vector();
 bool client_add(Dispatcher *dispatcher, socktype sock, sockaddr_in *saddr);
 bool client_remove(socktype sock);
-int client_handle(socktype sock, char data_[1024], std::size_t bytes);
+int client_handle(socktype sock, const char *data, std::size_t bytes);
 
-// used by GameController.cpp
+// used by GameController.cpp; from any game strand
 bool client_chat(int from_gid, int from_tid, int to, const char *message);
 bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *message);
 
@@ -51,6 +51,8 @@
 
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <boost/asio.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -78,41 +80,53 @@ typedef std::deque<message> message_queue;
 typedef std::map<socktype, session_ptr> session_map;
 typedef std::pair<socktype, session_ptr> socket_session_pair;
 
+// called from any thread; the lobby functions of game.cpp are run on the lobby strand
 class MessageDispatcher : public Dispatcher,
 public std::enable_shared_from_this<MessageDispatcher>
 {
 public:
     virtual int dispatch(socktype fd, string msg)
     {
-        
-        session_map::const_iterator pos = participants_.find(fd);
-        if (pos == participants_.end()) {
-            return 0;
-        } else {
-            session_ptr session =  pos->second;
+        session_ptr session;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
             
-            return session->deliver(fd, msg);
+            session_map::const_iterator pos = participants_.find(fd);
+            if (pos == participants_.end())
+                return 0;
+            
+            session = pos->second;
         }
-   
+        
+        return session->deliver(fd, msg);
     }
     
     
     
     bool registerSession(session_ptr participant, socktype sock, sockaddr_in *saddr) {
-        participants_.insert(socket_session_pair(sock, participant));
-        return client_add(this, sock, saddr);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            participants_.insert(socket_session_pair(sock, participant));
+        }
+        
+        sockaddr_in addr = *saddr;
+        lobby_strand().post([this, sock, addr]() mutable { client_add(this, sock, &addr); });
+        return true;
     }
     
     bool unregisterSession(session_ptr participant, socktype sock) {
-        participants_.erase(sock);
-        return client_remove(sock);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            participants_.erase(sock);
+        }
+        
+        lobby_strand().post([sock]() { client_remove(sock); });
+        return true;
     }
     
-    int handleSession(socktype sock, char data_[1024], std::size_t bytes) {
-        return client_handle(sock, data_, bytes);
-    }
 private:
     session_map participants_;
+    std::mutex mutex_;
     
 };
 
@@ -127,8 +141,9 @@ class session:
     public std::enable_shared_from_this<session>
 {
 public:
-    session(tcp::socket socket)
-    : socket_(std::move(socket))
+    session(boost::asio::io_service& io_service, tcp::socket socket)
+    : socket_(std::move(socket)),
+    strand_(io_service)
     {
     }
     
@@ -143,20 +158,23 @@ public:
         do_read();
     }
     
+    // from any thread; the queue is only touched on the session's strand
     virtual int deliver(socktype fd, string msg) {
-        // add the msg to the queue
-        message toWrite;
-        memset(&toWrite, 0, sizeof(message));
-        toWrite.sock = fd;
-        toWrite.msg = msg;
-
-        
-        bool write_in_progress = !write_msgs_.empty();
-        write_msgs_.push_back(toWrite);
-        if (!write_in_progress)
-        {
-            do_write();
-        }
+        auto self(shared_from_this());
+        strand_.post([this, self, fd, msg]()
+                     {
+                         // add the msg to the queue
+                         message toWrite;
+                         toWrite.sock = fd;
+                         toWrite.msg = msg;
+                         
+                         bool write_in_progress = !write_msgs_.empty();
+                         write_msgs_.push_back(toWrite);
+                         if (!write_in_progress)
+                         {
+                             do_write();
+                         }
+                     });
        
         return (int) msg.size();
     }
@@ -166,23 +184,25 @@ private:
     {
         auto self(shared_from_this());
         socket_.async_read_some(boost::asio::buffer(data_, max_length),
-                                [this, self](boost::system::error_code ec, std::size_t length)
+                                strand_.wrap([this, self](boost::system::error_code ec, std::size_t length)
                                 {
                                     int sender = socket_.native_handle();
                                     if (!ec)
                                     {
-                                        
-                                        int status = client_handle(sender, data_, length);
-                                        if (status <= 0)
+                                        // commands are executed on the lobby strand
+                                        const string data(data_, length);
+                                        lobby_strand().post([self, sender, data]()
                                         {
-                                            if (!status)
-                                                errno = 0;
-                                            log_msg("clientsock", "(%d) socket closed (%d: %s)", sender, errno, strerror(errno));
-                                            
-                                            dispatcher_singelton.unregisterSession(shared_from_this(), sender);
-                                            
-                                            
-                                        }
+                                            int status = client_handle(sender, data.data(), data.size());
+                                            if (status <= 0)
+                                            {
+                                                if (!status)
+                                                    errno = 0;
+                                                log_msg("clientsock", "(%d) socket closed (%d: %s)", sender, errno, strerror(errno));
+                                                
+                                                dispatcher_singelton.unregisterSession(self, sender);
+                                            }
+                                        });
                                         do_read();
                                     }
                                     else if ((boost::asio::error::eof == ec) ||
@@ -193,7 +213,7 @@ private:
                                         
                                         dispatcher_singelton.unregisterSession(shared_from_this(), sender);
                                     }
-                                });
+                                }));
     }
     
     void do_write()
@@ -203,7 +223,7 @@ private:
         boost::asio::async_write(socket_,
                                  boost::asio::buffer(write_msgs_.front().msg.data(),
                                                      write_msgs_.front().msg.size()),
-                                 [this, self](boost::system::error_code ec, std::size_t /*length*/)
+                                 strand_.wrap([this, self](boost::system::error_code ec, std::size_t /*length*/)
                                  {
                                      if (!ec)
                                      {
@@ -219,10 +239,11 @@ private:
                                          log_msg("clientsock", "Could not write. (%d) socket disconnected (%d: %s)", sender, 0, strerror(errno));
                                          dispatcher_singelton.unregisterSession(shared_from_this(), sender);
                                      }
-                                 });
+                                 }));
     }
     
     tcp::socket socket_;
+    boost::asio::io_service::strand strand_;
     enum { max_length = 1024 };
     char data_[max_length];
     message_queue write_msgs_;
@@ -234,7 +255,8 @@ class server
 {
 public:
     server(boost::asio::io_service& io_service, short port)
-    : acceptor_(io_service, tcp::endpoint(tcp::v4(), port)),
+    : io_service_(io_service),
+    acceptor_(io_service, tcp::endpoint(tcp::v4(), port)),
     socket_(io_service)
     {
         do_accept();
@@ -248,7 +270,7 @@ private:
                                {
                                    if (!ec)
                                    {
-                                       std::make_shared<session>(std::move(socket_))->start();
+                                       std::make_shared<session>(io_service_, std::move(socket_))->start();
                                    }
                                    
                                    do_accept();
@@ -256,6 +278,7 @@ private:
                                });
     }
     
+    boost::asio::io_service& io_service_;
     tcp::acceptor acceptor_;
     tcp::socket socket_;
     
@@ -294,8 +317,8 @@ void scheduleHandleGame(const boost::system::error_code& /*e*/,
 {
     gameloop();
     t->expires_at(t->expires_at() + boost::posix_time::seconds(1));
-    t->async_wait(boost::bind(scheduleHandleGame,
-                              boost::asio::placeholders::error, t));
+    t->async_wait(lobby_strand().wrap(boost::bind(scheduleHandleGame,
+                              boost::asio::placeholders::error, t)));
    
 }
 
@@ -333,24 +356,37 @@ int main(int argc, char* argv[])
             log_use_timestamp(1);
     }
     
-    gameloop();
-    
- 
-   
-    
     try
     {
         
         boost::asio::io_service io_service;
         
+        game_init(io_service);
+        lobby_strand().post(gameloop);
+        
         std::cerr << "Using port: " << config.getInt("port") << "\n";
         server s(io_service, config.getInt("port"));
         
+        // the game loop runs on the lobby strand; it hands the games to their strands
         boost::asio::deadline_timer t(io_service, boost::posix_time::seconds(5));
-        t.async_wait(boost::bind(scheduleHandleGame,
-                                 boost::asio::placeholders::error, &t));
+        t.async_wait(lobby_strand().wrap(boost::bind(scheduleHandleGame,
+                                 boost::asio::placeholders::error, &t)));
+        
+        // the calling thread is one of the I/O threads
+        unsigned int threads = config.getInt("io_threads");
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        
+        log_msg("server", "running %d I/O threads", threads);
+        
+        vector<std::thread> pool;
+        for (unsigned int i=1; i < threads; i++)
+            pool.push_back(std::thread([&io_service]() { io_service.run(); }));
         
         io_service.run();
+        
+        for (unsigned int i=0; i < pool.size(); i++)
+            pool[i].join();
     }
     catch (std::exception& e)
     {
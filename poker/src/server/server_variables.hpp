@@ -22,6 +22,7 @@
 
 config.set("version",			VERSION);		// config file version
 config.set("port",			DEFAULT_SERVER_PORT);	// port the server is listening on
+config.set("io_threads",		0);			// threads serving clients and games (0 is one per core)
 config.set("max_clients",		200);			// limit for client connections
 config.set("max_games",			100);			// limit for games
 config.set("max_connections_per_ip",	3);			// limit for connections per IP
@@ -36,6 +37,9 @@ config.set("flood_chat_interval",	10);			// flood-protect: interval for measurei
 config.set("flood_chat_per_interval",	5);			// flood-protect: count of messages allowed in interval
 config.set("flood_chat_mute",		60);			// flood-protect: mute time (seconds)
 config.set("welcome_message",		"");			// welcome message sent on state info
+config.set("equity_snapshots",		true);			// send all-in equity of players
+config.set("equity_threads",		1);			// threads computing all-in equity
+config.set("deck_pool",			1024);			// pre-shuffled decks kept by a background thread (0 shuffles inline)
 
 
 #ifdef DEBUG
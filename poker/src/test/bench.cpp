@@ -0,0 +1,474 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+/*
+	Micro-benchmarks of the core libpoker operations. Reports ns/op,
+	heap allocations/op and throughput as a table, optionally as JSON.
+	
+	Usage: poker_bench [-j <file.json>] [-f <filter>] [-t <ms per benchmark>]
+	
+	Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Card.hpp"
+#include "Deck.hpp"
+#include "HoleCards.hpp"
+#include "CommunityCards.hpp"
+#include "GameLogic.hpp"
+#include "Player.hpp"
+#include "Table.hpp"
+#include "Tokenizer.hpp"
+
+using namespace std;
+
+
+// count heap allocations of the whole program
+static unsigned long allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+
+// results are accumulated here, so the work can not be optimized away
+static volatile unsigned long sink;
+
+typedef struct {
+	string name;
+	function<void(unsigned long)> run;  // runs the operation n times
+	
+	unsigned long iterations;
+	double ns_per_op;
+	double allocs_per_op;
+	double ops_per_sec;
+} Benchmark;
+
+
+static void measure(Benchmark *b, double min_ms)
+{
+	typedef chrono::steady_clock clock;
+	
+	// warm up caches and lazily built tables
+	b->run(1);
+	
+	unsigned long n = 1;
+	for (;;)
+	{
+		const unsigned long allocs_start = allocations;
+		const clock::time_point start = clock::now();
+		
+		b->run(n);
+		
+		const double ns = chrono::duration<double, nano>(clock::now() - start).count();
+		const unsigned long allocs = allocations - allocs_start;
+		
+		if (ns >= min_ms * 1e6 || n >= (1UL << 40))
+		{
+			b->iterations = n;
+			b->ns_per_op = ns / n;
+			b->allocs_per_op = (double)allocs / n;
+			b->ops_per_sec = 1e9 / b->ns_per_op;
+			return;
+		}
+		
+		// aim at the minimum time with some headroom
+		const double scale = (ns > 0) ? (min_ms * 1e6 * 1.2) / ns : 100;
+		n = (unsigned long)(n * (scale > 100 ? 100 : (scale < 2 ? 2 : scale)));
+	}
+}
+
+
+static vector<Card> random_cards(unsigned int count)
+{
+	ChaCha20 rng;
+	Deck d(rng);
+	d.fill();
+	d.shuffle();
+	
+	vector<Card> cards;
+	for (unsigned int i=0; i < count; i++)
+	{
+		Card c;
+		d.pop(c);
+		cards.push_back(c);
+	}
+	
+	return cards;
+}
+
+static void bench_deck(vector<Benchmark> &benchmarks)
+{
+	Benchmark b;
+	
+	b.name = "Deck::fill+shuffle";
+	b.run = [](unsigned long n) {
+		ChaCha20 rng;
+		Deck d(rng);
+		for (unsigned long i=0; i < n; i++)
+		{
+			d.fill();
+			d.shuffle();
+		}
+		sink += d.count();
+	};
+	benchmarks.push_back(b);
+	
+	// 10 players and a full board from a shuffled deck
+	b.name = "deal 10 players+board";
+	b.run = [](unsigned long n) {
+		ChaCha20 rng;
+		Deck proto(rng);
+		proto.fill();
+		proto.shuffle();
+		
+		Deck d(rng);
+		HoleCards h[10];
+		CommunityCards cc;
+		
+		for (unsigned long i=0; i < n; i++)
+		{
+			d = proto;
+			
+			Card c1, c2, c3;
+			for (unsigned int p=0; p < 10; p++)
+			{
+				d.pop(c1);
+				d.pop(c2);
+				h[p].setCards(c1, c2);
+			}
+			
+			d.pop(c1); d.pop(c2); d.pop(c3);
+			cc.setFlop(c1, c2, c3);
+			d.pop(c1);
+			cc.setTurn(c1);
+			d.pop(c1);
+			cc.setRiver(c1);
+		}
+		sink += d.count();
+	};
+	benchmarks.push_back(b);
+}
+
+static void bench_strength(vector<Benchmark> &benchmarks)
+{
+	const unsigned int sets = 1024;
+	
+	for (unsigned int count=5; count <= 7; count++)
+	{
+		vector< vector<Card> > hands;
+		for (unsigned int i=0; i < sets; i++)
+			hands.push_back(random_cards(count));
+		
+		Benchmark b;
+		b.name = "GameLogic::getStrength " + to_string(count) + " cards";
+		b.run = [hands](unsigned long n) {
+			HandStrength strength;
+			vector<Card> cards;
+			unsigned long sum = 0;
+			
+			for (unsigned long i=0; i < n; i++)
+			{
+				cards = hands[i % sets];
+				GameLogic::getStrength(&cards, &strength);
+				sum += strength.getKey();
+			}
+			sink += sum;
+		};
+		benchmarks.push_back(b);
+	}
+	
+	vector<HandStrength> strengths(sets);
+	for (unsigned int i=0; i < sets; i++)
+	{
+		vector<Card> cards = random_cards(7);
+		GameLogic::getStrength(&cards, &strengths[i]);
+	}
+	
+	Benchmark b;
+	b.name = "HandStrength compare";
+	b.run = [strengths](unsigned long n) {
+		unsigned long sum = 0;
+		
+		for (unsigned long i=0; i < n; i++)
+		{
+			const HandStrength &a = strengths[i % sets];
+			const HandStrength &c = strengths[(i + 1) % sets];
+			
+			sum += (a < c) + (a == c);
+		}
+		sink += sum;
+	};
+	benchmarks.push_back(b);
+}
+
+static void bench_winlist(vector<Benchmark> &benchmarks)
+{
+	const unsigned int sets = 256;
+	
+	for (unsigned int players=2; players <= WinList::MaxHands; players++)
+	{
+		// hands of the players against a common board
+		vector<HandStrength> strengths;
+		
+		for (unsigned int i=0; i < sets; i++)
+		{
+			vector<Card> cards = random_cards(5 + 2*players);
+			
+			for (unsigned int p=0; p < players; p++)
+			{
+				vector<Card> hand(cards.begin(), cards.begin() + 5);
+				hand.push_back(cards[5 + 2*p]);
+				hand.push_back(cards[5 + 2*p + 1]);
+				
+				HandStrength strength;
+				GameLogic::getStrength(&hand, &strength);
+				strength.setId(p);
+				strengths.push_back(strength);
+			}
+		}
+		
+		Benchmark b;
+		b.name = "GameLogic::getWinList " + to_string(players) + " players";
+		b.run = [strengths, players](unsigned long n) {
+			WinList wl;
+			unsigned long sum = 0;
+			
+			for (unsigned long i=0; i < n; i++)
+			{
+				GameLogic::getWinList(&strengths[(i % sets) * players], players, &wl);
+				sum += wl.getGroupCount();
+			}
+			sink += sum;
+		};
+		benchmarks.push_back(b);
+	}
+}
+
+
+// access to the table's internals for the side-pot benchmark
+class TableBench
+{
+public:
+	static void run(unsigned long n)
+	{
+		Table t;
+		
+		// 10 players with different all-in amounts: 9 side pots
+		for (unsigned int i=0; i < 10; i++)
+		{
+			Seat &seat = t.seats[i];
+			seat.seat_no = i;
+			seat.occupied = true;
+			seat.player = make_shared<Player>();
+			seat.player->client_id = i;
+		}
+		
+		unsigned long sum = 0;
+		
+		for (unsigned long r=0; r < n; r++)
+		{
+			t.pots.clear();
+			Table::Pot pot;
+			pot.amount = 0;
+			pot.final = false;
+			t.pots.push_back(pot);
+			
+			for (unsigned int i=0; i < 10; i++)
+			{
+				Seat &seat = t.seats[i];
+				seat.in_round = (i != 9);  // one folded player
+				seat.bet = 100 * (i + 1);
+				seat.player->stake = (i % 3) ? 0 : 500;
+			}
+			
+			t.collectBets();
+			sum += t.pots.size();
+		}
+		
+		sink += sum;
+	}
+};
+
+static void bench_table(vector<Benchmark> &benchmarks)
+{
+	Benchmark b;
+	b.name = "Table::collectBets side pots";
+	b.run = TableBench::run;
+	benchmarks.push_back(b);
+}
+
+static void bench_tokenizer(vector<Benchmark> &benchmarks)
+{
+	static const char *lines[] = {
+		"PCLIENT 5",
+		"12 ACTION 0 raise 200",
+		"13 CHAT 1 \"good luck, have fun\"",
+		"REQUEST clientinfo 1 2 3 4",
+		"14 REGISTER 0",
+	};
+	const unsigned int count = sizeof(lines) / sizeof(lines[0]);
+	
+	vector<string> protocol(lines, lines + count);
+	
+	Benchmark b;
+	b.name = "Tokenizer::parse";
+	b.run = [protocol, count](unsigned long n) {
+		Tokenizer t(" ");
+		unsigned long sum = 0;
+		
+		for (unsigned long i=0; i < n; i++)
+		{
+			t.parse(protocol[i % count]);
+			sum += t.count();
+		}
+		sink += sum;
+	};
+	benchmarks.push_back(b);
+}
+
+
+static void print_table(const vector<Benchmark> &benchmarks)
+{
+	printf("%-36s %12s %12s %12s %14s\n", "benchmark", "iterations", "ns/op", "allocs/op", "ops/s");
+	
+	for (unsigned int i=0; i < benchmarks.size(); i++)
+	{
+		const Benchmark &b = benchmarks[i];
+		
+		printf("%-36s %12lu %12.1f %12.2f %14.0f\n",
+			b.name.c_str(), b.iterations, b.ns_per_op, b.allocs_per_op, b.ops_per_sec);
+	}
+}
+
+static bool write_json(const vector<Benchmark> &benchmarks, const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+	{
+		perror("fopen");
+		return false;
+	}
+	
+	fprintf(fp, "{\n\t\"benchmarks\": [\n");
+	
+	for (unsigned int i=0; i < benchmarks.size(); i++)
+	{
+		const Benchmark &b = benchmarks[i];
+		
+		fprintf(fp, "\t\t{ \"name\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.3f, "
+			"\"allocs_per_op\": %.3f, \"ops_per_sec\": %.1f }%s\n",
+			b.name.c_str(), b.iterations, b.ns_per_op, b.allocs_per_op, b.ops_per_sec,
+			(i < benchmarks.size() - 1) ? "," : "");
+	}
+	
+	fprintf(fp, "\t]\n}\n");
+	
+	return fclose(fp) == 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *json = NULL;
+	const char *filter = NULL;
+	double min_ms = 200;
+	
+	for (int i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			json = argv[++i];
+		else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+			filter = argv[++i];
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			min_ms = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [-j <file.json>] [-f <filter>] [-t <ms per benchmark>]\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	vector<Benchmark> all, benchmarks;
+	bench_deck(all);
+	bench_strength(all);
+	bench_winlist(all);
+	bench_table(all);
+	bench_tokenizer(all);
+	
+	for (unsigned int i=0; i < all.size(); i++)
+	{
+		if (filter && all[i].name.find(filter) == string::npos)
+			continue;
+		
+		measure(&all[i], min_ms);
+		benchmarks.push_back(all[i]);
+	}
+	
+	print_table(benchmarks);
+	
+	if (json && !write_json(benchmarks, json))
+		return 1;
+	
+	return 0;
+}
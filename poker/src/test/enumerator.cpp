@@ -0,0 +1,228 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+/*
+	Exhaustive enumeration of all 5- and 7-card short-deck hands on all
+	cores. Prints the exact count per category, compares them with the
+	known totals and cross-checks the table evaluator against the
+	rule-based GameLogic::getStrengthByRules().
+	
+	Usage: enumerator [-t <threads>] [-n <5|7>] [-q]
+	  -q   count only; skip the cross-check
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+#include "Deck.hpp"
+#include "GameLogic.hpp"
+#include "HandEvaluator.hpp"
+
+using namespace std;
+
+
+static const unsigned int Categories = HandStrength::StraightFlush + 1;
+
+// known totals per HandStrength::Ranking of the 36-card deck
+static const unsigned long expected5[Categories] = {
+	122400, 193536, 36288, 16128, 6120, 1728, 480, 288, 24
+};
+
+static const unsigned long expected7[Categories] = {
+	233100, 2316600, 3157056, 607200, 1169940, 633024, 175560, 44640, 10560
+};
+
+typedef struct {
+	unsigned long count[Categories];
+	unsigned long mismatches;
+} Result;
+
+
+// all hands of 'k' cards with cards[first] as the lowest card
+static void enumerate_first(const vector<Card> &cards, unsigned int k, unsigned int first, bool check, Result *res)
+{
+	const unsigned int n = cards.size();
+	
+	unsigned int idx[7];
+	idx[0] = first;
+	for (unsigned int i=1; i < k; i++)
+		idx[i] = first + i;
+	
+	if (idx[k - 1] >= n)
+		return;
+	
+	vector<Card> hand(k);
+	
+	for (;;)
+	{
+		CardSet set;
+		for (unsigned int i=0; i < k; i++)
+		{
+			hand[i] = cards[idx[i]];
+			set.add(hand[i]);
+		}
+		
+		const unsigned int key = HandEvaluator::evaluate(set);
+		res->count[HandEvaluator::getRanking(key)]++;
+		
+		if (check)
+		{
+			HandStrength strength;
+			vector<Card> v(hand);
+			GameLogic::getStrengthByRules(&v, &strength);
+			
+			if (strength.getKey() != key || HandEvaluator::evaluate(hand) != key)
+				res->mismatches++;
+		}
+		
+		// next combination; idx[0] stays fixed
+		int i = k - 1;
+		while (i > 0 && idx[i] == n - k + i)
+			i--;
+		
+		if (i == 0)
+			break;
+		
+		idx[i]++;
+		for (unsigned int j=i+1; j < k; j++)
+			idx[j] = idx[j - 1] + 1;
+	}
+}
+
+static bool enumerate(unsigned int k, unsigned int threads, bool check)
+{
+	ChaCha20 rng;
+	Deck d(rng);
+	d.fill();
+	
+	vector<Card> cards;
+	Card c;
+	while (d.pop(c))
+		cards.push_back(c);
+	
+	// work units are the lowest card of a hand; dealt out dynamically
+	// as their sizes differ widely
+	atomic<unsigned int> next_first(0);
+	vector<Result> results(threads);
+	vector<thread> pool;
+	
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	for (unsigned int t=0; t < threads; t++)
+	{
+		memset(&results[t], 0, sizeof(Result));
+		
+		pool.push_back(thread([&, t]() {
+			unsigned int first;
+			while ((first = next_first++) < cards.size())
+				enumerate_first(cards, k, first, check, &results[t]);
+		}));
+	}
+	
+	Result total;
+	memset(&total, 0, sizeof(Result));
+	
+	for (unsigned int t=0; t < threads; t++)
+	{
+		pool[t].join();
+		
+		for (unsigned int i=0; i < Categories; i++)
+			total.count[i] += results[t].count[i];
+		total.mismatches += results[t].mismatches;
+	}
+	
+	const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	
+	const unsigned long *expected = (k == 5) ? expected5 : expected7;
+	unsigned long hands = 0;
+	bool ok = true;
+	
+	for (unsigned int i=0; i < Categories; i++)
+		hands += total.count[i];
+	
+	printf("%u-card hands: %lu (%.2fs, %.0f hands/s, %u threads)\n",
+		k, hands, secs, hands / secs, threads);
+	
+	for (unsigned int i=0; i < Categories; i++)
+	{
+		const bool match = (total.count[i] == expected[i]);
+		
+		printf("  %-16s %10lu  %8.5f%%  %s\n",
+			HandStrength::getRankingName((HandStrength::Ranking)i),
+			total.count[i], 100.0 * total.count[i] / hands,
+			match ? "ok" : "MISMATCH");
+		
+		ok = ok && match;
+	}
+	
+	if (check)
+	{
+		printf("  cross-check: %lu mismatches\n", total.mismatches);
+		ok = ok && !total.mismatches;
+	}
+	
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int threads = thread::hardware_concurrency();
+	unsigned int only = 0;
+	bool check = true;
+	
+	for (int i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			only = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-q"))
+			check = false;
+		else
+		{
+			fprintf(stderr, "Usage: %s [-t <threads>] [-n <5|7>] [-q]\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	if (!threads)
+		threads = 1;
+	
+	bool ok = true;
+	
+	if (!only || only == 5)
+		ok = enumerate(5, threads, check) && ok;
+	
+	if (!only || only == 7)
+		ok = enumerate(7, threads, check) && ok;
+	
+	return ok ? 0 : 1;
+}
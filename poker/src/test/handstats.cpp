@@ -0,0 +1,230 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+/*
+	Deals hands the way the server does (Deck, HoleCards, CommunityCards)
+	on all cores and collects HandStatistics for auditing. Each thread
+	counts into its own shard and merges it into the total after every
+	batch; the total is checkpointed periodically and a run can be
+	resumed from its checkpoint.
+	
+	Usage: handstats [-t <threads>] [-n <hands>] [-p <players>] [-c <checkpoint>] [-i <seconds>]
+	  -n   total hands, including those of a resumed checkpoint
+	  -c   resume from and save to this file
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Card.hpp"
+#include "Deck.hpp"
+#include "HoleCards.hpp"
+#include "CommunityCards.hpp"
+#include "GameLogic.hpp"
+#include "HandStatistics.hpp"
+
+using namespace std;
+
+
+static const unsigned long Batch = 10000;
+
+static HandStatistics total;
+static mutex total_mutex;
+static condition_variable finished;
+static atomic<long> remaining;
+static unsigned int running;
+
+
+static void deal(unsigned int players)
+{
+	HandStatistics shard;
+	ChaCha20 rng;
+	Deck deck(rng);
+	HoleCards holes[10];
+	CommunityCards cc;
+	
+	for (;;)
+	{
+		// claim a batch
+		const long left = remaining.fetch_sub(Batch);
+		if (left <= 0)
+			break;
+		
+		const unsigned long hands = min<unsigned long>(left, Batch);
+		
+		for (unsigned long i=0; i < hands; i++)
+		{
+			deck.fill();
+			deck.shuffle();
+			
+			Card c1, c2;
+			for (unsigned int p=0; p < players; p++)
+			{
+				deck.pop(c1);
+				deck.pop(c2);
+				holes[p].setCards(c1, c2);
+			}
+			
+			Card f1, f2, f3, t, r;
+			deck.pop(f1);
+			deck.pop(f2);
+			deck.pop(f3);
+			deck.pop(t);
+			deck.pop(r);
+			
+			cc.clear();
+			cc.setFlop(f1, f2, f3);
+			cc.setTurn(t);
+			cc.setRiver(r);
+			
+			shard.add(holes, players, &cc);
+		}
+		
+		lock_guard<mutex> lock(total_mutex);
+		total.merge(shard);
+		shard.clear();
+	}
+	
+	lock_guard<mutex> lock(total_mutex);
+	if (!--running)
+		finished.notify_one();
+}
+
+static void print(const HandStatistics &s, double secs, unsigned long dealt)
+{
+	printf("%lu hands, %lu player hands\n", s.getHands(), s.getPlayerHands());
+	
+	for (unsigned int c=0; c < HandStatistics::Categories; c++)
+		printf("  %-16s %12lu  %9.6f%%   board %12lu\n",
+			HandStrength::getRankingName((HandStrength::Ranking)c), s.getCategory(c),
+			100.0 * s.getCategory(c) / s.getPlayerHands(),
+			s.getBoardCategory(c));
+	
+	printf("  flop: rainbow %lu, two-tone %lu, monotone %lu, paired %lu\n",
+		s.getFlopTexture(HandStatistics::Rainbow),
+		s.getFlopTexture(HandStatistics::TwoTone),
+		s.getFlopTexture(HandStatistics::Monotone),
+		s.getPairedFlops());
+	
+	// 35 degrees of freedom: 99.9% of fair decks stay below 66.6
+	printf("  card chi-square by position:");
+	for (unsigned int p=0; p < HandStatistics::Positions; p++)
+		printf(" %.1f", s.getChiSquare(p));
+	printf("\n");
+	
+	if (secs > 0)
+		printf("%lu hands dealt in %.2fs: %.0f hands/s\n", dealt, secs, dealt / secs);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int threads = thread::hardware_concurrency();
+	unsigned long hands = 1000000;
+	unsigned int players = 2;
+	unsigned int interval = 10;
+	const char *checkpoint = 0;
+	
+	for (int i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			hands = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			players = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+			checkpoint = argv[++i];
+		else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			interval = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [-t <threads>] [-n <hands>] [-p <players>] [-c <checkpoint>] [-i <seconds>]\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	if (!threads)
+		threads = 1;
+	
+	if (players < 1 || players > 10)
+	{
+		fprintf(stderr, "Players must be 1 to 10\n");
+		return 1;
+	}
+	
+	if (checkpoint && total.load(checkpoint))
+		printf("Resuming from %s at %lu hands\n", checkpoint, total.getHands());
+	
+	const unsigned long start_hands = total.getHands();
+	remaining = (hands > start_hands) ? hands - start_hands : 0;
+	running = threads;
+	
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	vector<thread> workers;
+	for (unsigned int i=0; i < threads; i++)
+		workers.push_back(thread(deal, players));
+	
+	// checkpoint until all threads are done
+	{
+		unique_lock<mutex> lock(total_mutex);
+		
+		while (!finished.wait_for(lock, chrono::seconds(interval), [] { return !running; }))
+		{
+			if (!checkpoint)
+				continue;
+			
+			const HandStatistics snapshot = total;
+			lock.unlock();
+			
+			if (!snapshot.save(checkpoint))
+				fprintf(stderr, "Saving checkpoint %s failed\n", checkpoint);
+			else
+				printf("Checkpoint at %lu hands\n", snapshot.getHands());
+			
+			lock.lock();
+		}
+	}
+	
+	for (unsigned int i=0; i < threads; i++)
+		workers[i].join();
+	
+	const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	if (checkpoint && !total.save(checkpoint))
+	{
+		fprintf(stderr, "Saving checkpoint %s failed\n", checkpoint);
+		return 1;
+	}
+	
+	print(total, secs, total.getHands() - start_hands);
+	
+	return 0;
+}
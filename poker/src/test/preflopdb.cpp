@@ -0,0 +1,199 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+/*
+	Writes the heads-up preflop equity database read by PreflopEquity.
+	Every matchup of two starting hands is enumerated exactly, once per
+	class of matchups equal up to a permutation of suits; a matchup
+	seen the other way round is derived from it.
+	
+	Usage: preflopdb [-t <threads>] <file>
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Card.hpp"
+#include "CardSet.hpp"
+#include "EquityEngine.hpp"
+#include "PreflopEquity.hpp"
+
+using namespace std;
+
+
+typedef pair<uint64_t, uint64_t> Matchup;
+
+static const unsigned int Hands = PreflopEquity::Hands;
+
+// boards dealt from the 32 cards left
+static const unsigned int Runouts = 201376;
+
+
+// smallest image of the matchup under all suit permutations
+static Matchup canonical(const CardSet &a, const CardSet &b)
+{
+	unsigned char perm[4] = { 0, 1, 2, 3 };
+	Matchup best(~(uint64_t)0, ~(uint64_t)0);
+	
+	do {
+		const Matchup m(a.permuteSuits(perm).getMask(), b.permuteSuits(perm).getMask());
+		if (m < best)
+			best = m;
+	} while (next_permutation(perm, perm + 4));
+	
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int threads = 0;
+	const char *filename = 0;
+	
+	for (int i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-t") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!filename && argv[i][0] != '-')
+			filename = argv[i];
+		else
+		{
+			filename = 0;
+			break;
+		}
+	}
+	
+	if (!filename)
+	{
+		fprintf(stderr, "Usage: %s [-t <threads>] <file>\n", argv[0]);
+		return 1;
+	}
+	
+	// starting hands by PreflopEquity::getHandIndex()
+	vector<CardSet> hands(Hands);
+	vector<Card> cards;
+	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		for (int su=Card::FirstSuit; su <= Card::LastSuit; su++)
+			cards.push_back(Card((Card::Face)f, (Card::Suit)su));
+	for (unsigned int i=0; i < cards.size(); i++)
+		for (unsigned int j=i+1; j < cards.size(); j++)
+			hands[PreflopEquity::getHandIndex(cards[i], cards[j])] = CardSet(cards[i]) | CardSet(cards[j]);
+	
+	// classify all matchups
+	vector<uint16_t> matchups(Hands * Hands, PreflopEquity::NoMatchup);
+	vector<pair<unsigned int, unsigned int> > reps;
+	map<Matchup, uint16_t> classes;
+	
+	for (unsigned int a=0; a < Hands; a++)
+		for (unsigned int b=0; b < Hands; b++)
+		{
+			if (hands[a].intersects(hands[b]))
+				continue;
+			
+			const Matchup m = canonical(hands[a], hands[b]);
+			map<Matchup, uint16_t>::iterator it = classes.find(m);
+			
+			if (it == classes.end())
+			{
+				it = classes.insert(make_pair(m, (uint16_t)reps.size())).first;
+				reps.push_back(make_pair(a, b));
+			}
+			
+			matchups[a * Hands + b] = it->second;
+		}
+	
+	printf("%u hands, %u matchup classes\n", Hands, (unsigned int)reps.size());
+	
+	// equity of each class
+	EquityEngine engine(threads);
+	vector<PreflopEquity::Entry> entries(reps.size());
+	unsigned int enumerated = 0;
+	
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	for (unsigned int c=0; c < reps.size(); c++)
+	{
+		const unsigned int a = reps[c].first, b = reps[c].second;
+		const uint16_t reverse = matchups[b * Hands + a];
+		
+		if (reverse < c)
+		{
+			entries[c].wins = Runouts - entries[reverse].wins - entries[reverse].ties;
+			entries[c].ties = entries[reverse].ties;
+			continue;
+		}
+		
+		EquityRequest req;
+		req.holes.push_back(hands[a]);
+		req.holes.push_back(hands[b]);
+		req.trials = Runouts;
+		
+		EquityResult res;
+		if (!engine.calculate(req, &res) || !res.exact || res.trials != Runouts)
+		{
+			fprintf(stderr, "Enumeration of matchup class %u failed\n", c);
+			return 1;
+		}
+		
+		entries[c].wins = (uint32_t) lround(res.players[0].win * Runouts);
+		entries[c].ties = (uint32_t) lround(res.players[0].tie * Runouts);
+		
+		if (++enumerated % 500 == 0)
+		{
+			printf("  %u/%u\n", c + 1, (unsigned int)reps.size());
+			fflush(stdout);
+		}
+	}
+	
+	const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("%u matchups enumerated (%.1fs, %u threads)\n", enumerated, secs, engine.getThreadCount());
+	
+	
+	FILE *fp = fopen(filename, "wb");
+	if (!fp)
+	{
+		perror("fopen");
+		return 1;
+	}
+	
+	PreflopEquity::Header header;
+	PreflopEquity::fillHeader(&header, reps.size(), Runouts);
+	
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		fwrite(&matchups[0], sizeof(uint16_t), matchups.size(), fp) == matchups.size() &&
+		fwrite(&entries[0], sizeof(PreflopEquity::Entry), entries.size(), fp) == entries.size();
+	
+	if (fclose(fp) || !ok)
+	{
+		fprintf(stderr, "Writing %s failed\n", filename);
+		return 1;
+	}
+	
+	return 0;
+}
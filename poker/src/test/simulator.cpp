@@ -21,242 +21,218 @@
  */
 
 
+/*
+	Deals random 7-card short-deck hands on all cores and compares the
+	frequency of each hand category with its exact probability. Each
+	thread deals only the 7 cards it needs from its own deck and RNG; the
+	hands/s figure serves as a throughput benchmark.
+	
+	Usage: simulator [-t|--threads <n>] [-s <seed>] [-H <hole-cards>] [iterations]
+	  -H   equity of the hole-cards (e.g. 7c7h) against a random hand
+*/
+
 #include <cstdio>
 #include <cstdlib>
-#include <ctime>
-
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <thread>
 #include <vector>
-#include <algorithm>
 
-#include "Debug.h"
 #include "Card.hpp"
-#include "Deck.hpp"
-#include "HoleCards.hpp"
-#include "CommunityCards.hpp"
+#include "CardSet.hpp"
 #include "GameLogic.hpp"
-
-#if 0
-#define HW_RANDOM	"/dev/urandom"
-#endif
+#include "HandEvaluator.hpp"
+#include "EquityEngine.hpp"
 
 using namespace std;
 
-/* Combination probabilities:
- * 	http://de.wikipedia.org/wiki/Texas_Holdem#Wahrscheinlichkeiten
- *
- * Start-Hand vs. Random-Hand (Heads-Up) probabilities:
- * 	http://www.thema-poker.com/wahrscheinlichkeiten/starthaende
- */
- 
-int main(int argc, char **argv)
+
+// all categories + royal flush
+static const unsigned int Categories = HandStrength::StraightFlush + 2;
+
+/* 7-card hands of the 36-card deck per category, of C(36,7) = 8347680 */
+static const struct {
+	const char *str;
+	const unsigned long count;
+} rankings[Categories] = {
+	{ "High Card",		233100	},
+	{ "One Pair",		2316600	},
+	{ "Two Pair",		3157056	},
+	{ "Three Of A Kind",	607200	},
+	{ "Straight",		1169940	},
+	{ "Full House",		633024	},
+	{ "Flush",		175560	},
+	{ "Four Of A Kind",	44640	},
+	{ "Straight Flush",	8700	},
+	{ "Royal Flush",	1860	}
+};
+
+static const double Hands7 = 8347680;
+
+
+typedef struct {
+	unsigned long count[Categories];
+} Tally;
+
+static void simulate(unsigned long hands, uint64_t seed, unsigned int royal, Tally *t)
 {
-	printf("Poker Hand-Simulator\n");
+	mt19937_64 rng(seed);
 	
-	unsigned long tests;
+	Card deck[36];
+	unsigned int n = 0;
+	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+			deck[n++] = Card((Card::Face)f, (Card::Suit)s);
+	
+	for (unsigned long i=0; i < hands; i++)
+	{
+		// partial Fisher-Yates of the 7 cards dealt
+		for (unsigned int j=0; j < 7; j++)
+		{
+			const unsigned int k = j + (unsigned int)(((rng() >> 32) * (36 - j)) >> 32);
+			swap(deck[j], deck[k]);
+		}
+		
+		const unsigned int key = HandEvaluator::evaluate(deck, 7);
+		
+		if (key == royal)
+			t->count[Categories - 1]++;
+		else
+			t->count[HandEvaluator::getRanking(key)]++;
+	}
+}
+
+// a card of the short deck; Card() would take any symbol
+static bool parse_card(const char *str, Card *c)
+{
+	static const char face_symbols[] = "6789TJQKA";
+	static const char suit_symbols[] = "cdhs";
 	
-	if (argc < 2)
-		tests = 10000000;
-	else
-		tests = atoi(argv[1]);
+	const char *f = str[0] ? strchr(face_symbols, str[0]) : 0;
+	const char *s = str[1] ? strchr(suit_symbols, str[1]) : 0;
+	if (!f || !s)
+		return false;
 	
-#ifdef HW_RANDOM
-	FILE *fp = fopen(HW_RANDOM, "r");
-#else
-	// init PRNG
-	srand((unsigned) time(NULL));
-#endif /* HW_RANDOM */
+	*c = Card((Card::Face)(Card::FirstFace + (f - face_symbols)),
+		(Card::Suit)(Card::FirstSuit + (s - suit_symbols)));
+	return true;
+}
+
+static int headsup(const char *cards, unsigned long tests, unsigned int threads, uint64_t seed)
+{
+	Card c1, c2;
+	if (strlen(cards) != 4 || !parse_card(cards, &c1) || !parse_card(cards + 2, &c2))
+	{
+		fprintf(stderr, "Invalid hole-cards '%s'\n", cards);
+		return 1;
+	}
 	
-	struct {
-		const char *str;
-		const double probab;
-	} rankings[] = {
-		{ "High Card",		.17411920	},
-		{ "One Pair",		.438322546	},
-		{ "Two Pair",		.23495536	},
-		{ "Three Of A Kind", 	.04829870	},
-		{ "Straight",		.0461938	},
-		{ "Flush",		.0303255	},
-		{ "Full House",		.02596102	},
-		{ "Four Of A Kind",	.00168067	},
-		{ "Straight Flush",	.00027851	},
-		{ "Royal Flush",	.00003232	}
-	};
+	EquityRequest req;
+	req.holes.resize(2);
+	req.holes[0].add(c1);
+	req.holes[0].add(c2);
+	req.trials = tests;
+	req.seed = seed;
 	
+	EquityEngine engine(threads);
+	EquityResult res;
 	
-	printf("Iterations: %ld\n", tests);
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
 	
-	if (true)
+	if (req.holes[0].count() != 2 || !engine.calculate(req, &res))
 	{
-		// all combinations + RoyalFlush
-		const int strengths = (HandStrength::StraightFlush - HandStrength::HighCard +1) +1;
-		long int count[strengths];
-		int last_progress = 0;
-		
-		for (int i=0; i < strengths; i++)
-			count[i] = 0;
-		
-		printf(".");
-		
-		for (unsigned long i=0; i < tests; i++)
-		{
-#ifdef HW_RANDOM
-			unsigned long seed;
-			size_t read_elements;
-			read_elements = fread(&seed, sizeof(seed), 1, fp);
-			
-			if (read_elements*sizeof(seed) != sizeof(seed))
-			{
-				fprintf(stderr, "Error reading from random device (bytes read: %d; bytes expected: %d).\n",
-					(int)read_elements, (int)sizeof(seed));
-				return -1;
-			}
-			
-			srand(seed);
-#endif /* HW_RANDOM */
-
-			// progress
-			if (!(i % 1000))
-			{
-				int progress = 80 * i / tests;
-				if (progress > last_progress)
-				{
-					printf(".");
-					fflush(stdout);
-					last_progress = progress;
-				}
-			}
-			
-			Deck *d = new Deck();
-			
-			d->fill();
-			d->shuffle();
-			
-			
-			HoleCards *h = new HoleCards();
-			
-			Card c1, c2;
-			d->pop(c1);
-			d->pop(c2);
-			h->setCards(c1, c2);
-			
-			
-			CommunityCards *cc = new CommunityCards();
-			
-			Card f1, f2, f3, t, r;
-			d->pop(f1);
-			d->pop(f2);
-			d->pop(f3);
-			cc->setFlop(f1, f2, f3);
-			d->pop(t);
-			cc->setTurn(t);
-			d->pop(r);
-			cc->setRiver(r);
-			
-			
-			HandStrength strength;
-			GameLogic::getStrength(h, cc, &strength);
-			
-			vector<Card> rank;
-			strength.copyRankCards(&rank);
-			
-			// handle RoyalFlush as special case
-			if (strength.getRanking() == HandStrength::StraightFlush && rank.front().getFace() == Card::Ace)
-				count[strengths-1]++;
-			else
-				count[strength.getRanking() - HandStrength::HighCard]++;
-			
-			delete cc;
-			delete h;
-			delete d;
-		}
-		
-		printf("\n");
-		
-		for (int i=0; i < strengths; i++)
-			printf("%.8lf (%+7.8lf = %+7.6lf%%) - %s\n",
-				(double)count[i] / (double) tests,
-				(double)count[i] / (double) tests - rankings[i].probab,
-				((double)count[i] / (double) tests - rankings[i].probab)*100.0,
-				rankings[i].str);
+		fprintf(stderr, "Invalid hole-cards '%s'\n", cards);
+		return 1;
 	}
 	
-	printf("--------------------------------------------------------------------------------\n");
+	const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	const EquityResult::Player &p = res.players[0];
 	
+	printf("%.2s %.2s - win %4.2lf%%, lose %4.2lf%%, split %4.2lf%% (+-%.2lf%%)\n",
+		cards, cards + 2,
+		100 * p.win, 100 * (1 - p.win - p.tie), 100 * p.tie, 196 * p.stderror);
+	printf("%lu hands in %.2fs: %.0f hands/s (%u threads)\n",
+		res.trials, secs, res.trials / secs, engine.getThreadCount());
 	
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	printf("Poker Hand-Simulator\n");
 	
-	if (false)
+	unsigned long tests = 10000000;
+	unsigned int threads = thread::hardware_concurrency();
+	uint64_t seed = 0;
+	const char *hole = 0;
+	
+	for (int i=1; i < argc; i++)
 	{
-		long int wincount = 0, losecount = 0, splitcount = 0;
-		
-		HoleCards *h1 = new HoleCards();
-		Card card1(Card::Seven,  Card::Clubs);
-		Card card2(Card::Seven,  Card::Hearts);
-		h1->setCards(card1, card2);
-		
-		
-		for (unsigned long i=0; i < tests; i++)
+		if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--threads")) && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			seed = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "-H") && i + 1 < argc)
+			hole = argv[++i];
+		else if (argv[i][0] != '-')
+			tests = strtoul(argv[i], NULL, 10);
+		else
 		{
-			Deck *d = new Deck();
-			
-			d->fill();
-			
-			// remove test-holecards
-			d->debugRemoveCard(card1);
-			d->debugRemoveCard(card2);
-			
-			d->shuffle();
-			
-			
-			HoleCards *h2 = new HoleCards();
-			
-			Card c1, c2;
-			d->pop(c1);
-			d->pop(c2);
-			h2->setCards(c1, c2);
-			
-			
-			CommunityCards *cc = new CommunityCards();
-			
-			Card f1, f2, f3, t, r;
-			d->pop(f1);
-			d->pop(f2);
-			d->pop(f3);
-			cc->setFlop(f1, f2, f3);
-			d->pop(t);
-			cc->setTurn(t);
-			d->pop(r);
-			cc->setRiver(r);
-			
-			
-			HandStrength strength1, strength2;
-			GameLogic::getStrength(h1, cc, &strength1);
-			GameLogic::getStrength(h2, cc, &strength2);
-			
-			if (strength1 > strength2)
-				wincount++;
-			else if (strength1 == strength2)
-				splitcount++;
-			else if (strength1 < strength2)
-				losecount++;
-			else { printf("Outch, bug in strength-operator.\n"); return 0; }
-			
-			delete cc;
-			delete h2;
-			delete d;
+			fprintf(stderr, "Usage: %s [-t|--threads <n>] [-s <seed>] [-H <hole-cards>] [iterations]\n", argv[0]);
+			return 1;
 		}
+	}
+	
+	if (!threads)
+		threads = 1;
+	
+	if (!seed)
+		seed = ((uint64_t)random_device()() << 32) | random_device()();
+	
+	printf("Iterations: %lu\n", tests);
+	
+	if (hole)
+		return headsup(hole, tests, threads, seed);
+	
+	
+	// key of a royal flush; any 7 cards holding one have the same key
+	const Card royal_cards[5] = { Card("As"), Card("Ks"), Card("Qs"), Card("Js"), Card("Ts") };
+	const unsigned int royal = HandEvaluator::evaluate(royal_cards, 5);
+	
+	vector<Tally> tally(threads, Tally());
+	vector<thread> workers;
+	
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	for (unsigned int i=0; i < threads; i++)
+	{
+		const unsigned long hands = tests / threads + (i < tests % threads);
+		workers.push_back(thread(simulate, hands, seed + i, royal, &tally[i]));
+	}
+	
+	for (unsigned int i=0; i < threads; i++)
+		workers[i].join();
+	
+	const double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	
+	
+	for (unsigned int c=0; c < Categories; c++)
+	{
+		unsigned long count = 0;
+		for (unsigned int i=0; i < threads; i++)
+			count += tally[i].count[c];
 		
-		printf("%s ", card1.getName());
-		printf("%s - ", card2.getName());
+		const double freq = (double)count / (double)tests;
+		const double probab = rankings[c].count / Hands7;
 		
-		printf("win %4.2lf%%, lose %4.2lf%%, split %4.2lf%%\n",
-			100 * ((double) wincount / (double) tests),
-			100 * ((double) losecount / (double) tests),
-			100 * ((double) splitcount / (double) tests));
+		printf("%.8lf (%+7.8lf = %+7.6lf%%) - %s\n",
+			freq, freq - probab, (freq - probab) * 100.0, rankings[c].str);
 	}
 	
-#ifdef HW_RANDOM
-	fclose(fp);
-#endif /* HW_RANDOM */
+	printf("--------------------------------------------------------------------------------\n");
+	printf("%lu hands in %.2fs: %.0f hands/s (%u threads)\n",
+		tests, secs, tests / secs, threads);
 	
 	return 0;
 }
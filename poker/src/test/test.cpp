@@ -23,25 +23,62 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
 #include <ctime>
 
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <type_traits>
 
 #include "Platform.h"
 #include "Logger.h"
 #include "Debug.h"
 
 #include "Card.hpp"
+#include "CardSet.hpp"
+#include "ChaCha20.hpp"
 #include "Deck.hpp"
 #include "HoleCards.hpp"
 #include "CommunityCards.hpp"
 #include "GameLogic.hpp"
+#include "GameDebug.hpp"
+#include "HandEvaluator.hpp"
+#include "EquityEngine.hpp"
+#include "PreflopEquity.hpp"
+#include "Range.hpp"
+#include "EquityCache.hpp"
+#include "HandStatistics.hpp"
+#include "EquityWorker.hpp"
+#include "DeckPool.hpp"
+#include "GameController.hpp"
+#include "Table.hpp"
+#include "Protocol.h"
 
 
 using namespace std;
 
+
+// GameController's messages go nowhere in the tests, except for equities
+static vector<string> equity_snapshots;
+
+bool client_chat(int from_gid, int from_tid, int to, const char *message)
+{
+	return true;
+}
+
+bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *message)
+{
+	if (sid == SnapPlayerEquity)
+		equity_snapshots.push_back(message);
+	
+	return true;
+}
+
 int test_card1()
 {
 	Card *c = new Card(Card::Ace, Card::Spades);
@@ -83,9 +120,40 @@ int test_card3()
 	return 0;
 }
 
+int test_card4()
+{
+	unsigned int errors = 0;
+	
+	if (sizeof(Card) != 1)
+		errors++;
+	
+	// names round trip and stay put
+	const char *first = Card(Card::Two, Card::Clubs).getName();
+	for (int f=Card::Two; f <= Card::Ace; f++)
+		for (int s=Card::FirstSuit; s <= Card::LastSuit; s++)
+		{
+			const Card c((Card::Face)f, (Card::Suit)s);
+			const Card p(c.getName());
+			if (p.getFace() != f || p.getSuit() != s || c.getName() != first + 3 * c.getCode())
+				errors++;
+		}
+	
+	if (strcmp(first, "2c") || strcmp(Card("As").getName(), "As"))
+		errors++;
+	
+	// unknown symbols
+	if (Card::convertFaceSymbol('x') != Card::FirstFace || Card::convertSuitSymbol('\xe4') != Card::FirstSuit)
+		errors++;
+	
+	printf("Card: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
 int test_deck1()
 {
-	Deck *d = new Deck();
+	ChaCha20 rng;
+	Deck *d = new Deck(rng);
 	
 	d->fill();
 	d->debug();
@@ -98,6 +166,169 @@ int test_deck1()
 	return 0;
 }
 
+int test_chacha1()
+{
+	unsigned int errors = 0;
+	
+	// RFC 8439, A.1 test vector #1: all-zero key, nonce and counter
+	const uint32_t zero[8] = {0};
+	const uint32_t expected[4] = { 0xade0b876, 0x903df1a0, 0xe56a5d40, 0x28bd8653 };
+	ChaCha20 known(zero);
+	for (unsigned int i=0; i < 4; i++)
+		if (known() != expected[i])
+			errors++;
+	
+	// OS-seeded engines differ and survive several rekeys
+	ChaCha20 a, b;
+	if (a() == b() && a() == b())
+		errors++;
+	
+	for (unsigned int i=0; i < 3 * ChaCha20::RekeyBlocks * 16; i++)
+		a();
+	if (!a.rekey())
+		errors++;
+	
+	printf("ChaCha20: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+int test_deck2()
+{
+	unsigned int errors = 0;
+	ChaCha20 rng;
+	Deck d(rng);
+	Card c;
+	
+	// every card exactly once, whatever the order
+	d.fill();
+	d.shuffle();
+	CardSet seen;
+	while (d.pop(c))
+	{
+		if (seen.contains(c))
+			errors++;
+		seen.add(c);
+	}
+	if (seen.count() != 36 || d.count())
+		errors++;
+	
+	// cards pushed after the shuffle come off first
+	d.fill();
+	d.shuffle();
+	d.push(Card("2c"));
+	if (d.count() != 37 || !d.pop(c) || c.getFace() != Card::Two || c.getSuit() != Card::Clubs)
+		errors++;
+	
+	// unshuffled stack order
+	d.empty();
+	d.push(Card("Ah"));
+	d.push(Card("6d"));
+	if (!d.pop(c) || c.getFace() != Card::Six || !d.pop(c) || c.getFace() != Card::Ace || d.pop(c))
+		errors++;
+	
+	d.fill(FullDeck::FirstFace);
+	if (d.count() != 52 || d.push(Card("As")))
+		errors++;
+	
+	// the first and the fifth dealt card are uniform
+	const unsigned int rounds = 36000;
+	unsigned int first[36] = {0}, fifth[36] = {0};
+	for (unsigned int i=0; i < rounds; i++)
+	{
+		d.fill();
+		d.shuffle();
+		for (unsigned int k=0; k < 5; k++)
+		{
+			d.pop(c);
+			const unsigned int idx = (c.getFace() - Card::FirstFace) * 4 + (c.getSuit() - Card::FirstSuit);
+			if (k == 0)
+				first[idx]++;
+			else if (k == 4)
+				fifth[idx]++;
+		}
+	}
+	for (unsigned int i=0; i < 36; i++)
+		if (first[i] < 800 || first[i] > 1200 || fifth[i] < 800 || fifth[i] > 1200)
+			errors++;
+	
+	printf("Deck: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+int test_deckpool1()
+{
+	unsigned int errors = 0;
+	DeckPool pool(8);
+	ChaCha20 rng;
+	Deck d(rng);
+	
+	const unsigned int rounds = 1000;
+	unsigned int taken = 0;
+	for (unsigned int i=0; i < rounds; i++)
+	{
+		if (!pool.pop(&d))
+		{
+			this_thread::sleep_for(chrono::microseconds(100));
+			continue;
+		}
+		taken++;
+		
+		CardSet seen;
+		Card c;
+		while (d.pop(c))
+			seen.add(c);
+		if (seen.count() != DeckPool::Cards)
+			errors++;
+	}
+	
+	unsigned long hits, misses;
+	pool.getStats(&hits, &misses);
+	if (!taken || hits != taken || hits + misses != rounds)
+		errors++;
+	
+	printf("Deck pool: %lu hits, %lu misses, %d errors\n", hits, misses, errors);
+	
+	return errors ? 1 : 0;
+}
+
+int test_holecards1()
+{
+	unsigned int errors = 0;
+	
+	HoleCards h;
+	if (h.size() || h.begin() != h.end())
+		errors++;
+	
+	h.setCards(Card("As"), Card("Kd"));
+	if (h.size() != 2 || h[0].getFace() != Card::Ace || h[1].getSuit() != Card::Diamonds
+		|| h.end() - h.begin() != 2)
+		errors++;
+	
+	CommunityCards cc;
+	if (cc.setTurn(Card("7c")) || cc.size())
+		errors++;
+	
+	cc.setFlop(Card("Qs"), Card("Js"), Card("7h"));
+	if (cc.setRiver(Card("6d")) || !cc.setTurn(Card("Ts")) || !cc.setRiver(Card("6d")) || cc.setRiver(Card("6c")))
+		errors++;
+	
+	CardSet all;
+	h.copyCards(&all);
+	cc.copyCards(&all);
+	if (cc.size() != 5 || cc[3].getFace() != Card::Ten || all.count() != 7)
+		errors++;
+	
+	cc.clear();
+	if (cc.size() || !std::is_trivially_copyable<HoleCards>::value || !std::is_trivially_copyable<CommunityCards>::value)
+		errors++;
+	
+	printf("Hole/community cards: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
 int test_handstrength1()
 {
 	HoleCards *h = new HoleCards();
@@ -132,7 +363,8 @@ int test_handstrength2()
 {
 	for(;;)
 	{
-		Deck *d = new Deck();
+		ChaCha20 rng;
+		Deck *d = new Deck(rng);
 		
 		d->fill();
 		d->shuffle();
@@ -198,7 +430,8 @@ int test_handstrength2()
 
 int test_winlist1()
 {
-	Deck d;
+	ChaCha20 rng;
+	Deck d(rng);
 	d.fill();
 	d.shuffle();
 	
@@ -251,6 +484,1102 @@ int test_winlist1()
 	return 0;
 }
 
+int test_winlist2()
+{
+	// groups must be strictly decreasing and keep the input order of ties
+	unsigned int errors = 0;
+	
+	for (unsigned int n=0; n < 100000; n++)
+	{
+		const unsigned int count = 1 + rand() % WinList::MaxHands;
+		HandStrength hs[WinList::MaxHands];
+		
+		for (unsigned int i=0; i < count; i++)
+		{
+			// few distinct hands for many ties
+			Card::Face f = (Card::Face)(Card::FirstFace + rand() % 3);
+			vector<Card> cards;
+			cards.push_back(Card(f, Card::Clubs));
+			cards.push_back(Card(f, Card::Diamonds));
+			cards.push_back(Card(Card::Ace, Card::Hearts));
+			cards.push_back(Card(Card::King, Card::Hearts));
+			cards.push_back(Card(Card::Queen, Card::Spades));
+			
+			GameLogic::getStrength(&cards, &hs[i]);
+			hs[i].setId(i);
+		}
+		
+		WinList wl;
+		GameLogic::getWinList(hs, count, &wl);
+		
+		unsigned int total = 0;
+		for (unsigned int g=0; g < wl.getGroupCount(); g++)
+		{
+			for (unsigned int i=0; i < wl.getGroupSize(g); i++)
+			{
+				const HandStrength &h = wl.get(g, i);
+				
+				if (!(h == wl.get(g, 0)) || !(h == hs[h.getId()]))
+					errors++;
+				if (i && h.getId() <= wl.get(g, i - 1).getId())
+					errors++;
+				
+				total++;
+			}
+			
+			if (g && !(wl.get(g, 0) < wl.get(g - 1, 0)))
+				errors++;
+		}
+		
+		if (total != count)
+			errors++;
+	}
+	
+	printf("Winlist: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+// access to the game's internals, as in gc_test
+class TestCaseGameController
+{
+public:
+	static unsigned int showdown1();
+	static unsigned int allinequity1();
+};
+
+unsigned int TestCaseGameController::showdown1()
+{
+	unsigned int errors = 0;
+	
+	// four all-in players: a main pot of 404 and side pots of 597 and 600
+	static const struct {
+		const char *c1, *c2;
+		chips_type stake;     // before the hand
+		chips_type bet;
+		chips_type expected;  // after the showdown
+	} players[] = {
+		{ "Ad", "Ac", 101, 101, 404 },    // full house wins the main pot
+		{ "Qc", "Jc", 300, 300, 299 },    // straight splits side pot 1 and gets its odd chip
+		{ "Qd", "Jh", 1000, 600, 1298 },  // straight splits side pot 1 and wins side pot 2
+		{ "8s", "9h", 1000, 600, 400 },   // a pair wins nothing
+	};
+	const unsigned int count = sizeof(players) / sizeof(players[0]);
+	
+	GameController g;
+	Table t;
+	
+	t.setTableId(0);
+	t.state = Table::Showdown;
+	t.nomoreaction = true;
+	t.dealer = 3;
+	t.sb = 0;
+	t.bb = 1;
+	t.cur_player = -1;
+	t.last_bet_player = 2;
+	
+	t.communitycards.setFlop(Card("As"), Card("Kh"), Card("7d"));
+	t.communitycards.setTurn(Card("7c"));
+	t.communitycards.setRiver(Card("Ts"));
+	t.board.clear();
+	for (unsigned int i=0; i < t.communitycards.size(); i++)
+		t.board.add(t.communitycards[i]);
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		Seat &seat = t.seats[i];
+		seat.seat_no = i;
+		seat.occupied = true;
+		seat.in_round = true;
+		seat.bet = players[i].bet;
+		seat.player = make_shared<Player>();
+		seat.player->client_id = i;
+		seat.player->stake = players[i].stake - players[i].bet;
+		seat.player->holecards.setCards(Card(players[i].c1), Card(players[i].c2));
+	}
+	
+	Table::Pot pot;
+	pot.amount = 0;
+	pot.final = false;
+	t.pots.push_back(pot);
+	t.collectBets();
+	
+	if (t.pots.size() != 3 || t.pots[0].amount != 404
+		|| t.pots[1].amount != 597 || t.pots[2].amount != 600)
+		errors++;
+	
+	g.stateShowdown(&t);
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		if (t.seats[i].player->stake != players[i].expected)
+		{
+			printf("Showdown: seat %d has %d chips, expected %d\n",
+				i, t.seats[i].player->stake, players[i].expected);
+			errors++;
+		}
+	}
+	
+	if (!t.pots.empty())
+		errors++;
+	
+	return errors;
+}
+
+int test_showdown1()
+{
+	const unsigned int errors = TestCaseGameController::showdown1();
+	
+	printf("Showdown: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+int test_evaluator1()
+{
+	// compare table lookup with rule-by-rule evaluation
+	const unsigned int hands = 100000;
+	unsigned int mismatches = 0;
+	
+	ChaCha20 rng;
+	for (unsigned int i=0; i < hands; i++)
+	{
+		Deck d(rng);
+		d.fill();
+		d.shuffle();
+		
+		vector<Card> allcards;
+		const unsigned int count = 5 + i % 3;
+		for (unsigned int j=0; j < count; j++)
+		{
+			Card c;
+			d.pop(c);
+			allcards.push_back(c);
+		}
+		
+		vector<Card> rulecards = allcards;
+		HandStrength strength, rulestrength, setstrength;
+		GameLogic::getStrength(&allcards, &strength);
+		GameLogic::getStrengthByRules(&rulecards, &rulestrength);
+		GameLogic::getStrength(CardSet(allcards), &setstrength);
+		
+		if (!(strength == rulestrength) || !(strength == setstrength))
+		{
+			print_cards("Mismatch", &allcards);
+			mismatches++;
+		}
+	}
+	
+	printf("Evaluator: %d hands, %d mismatches\n", hands, mismatches);
+	
+	return mismatches ? 1 : 0;
+}
+
+int test_evaluator2()
+{
+	// compare batch evaluation with single evaluation
+	const unsigned int boards = 1000, hands = 101;
+	unsigned int mismatches = 0;
+	
+	ChaCha20 rng;
+	for (unsigned int i=0; i < boards; i++)
+	{
+		Deck d(rng);
+		d.fill();
+		d.shuffle();
+		
+		Card f1, f2, f3, t, r;
+		CommunityCards cc;
+		
+		d.pop(f1); d.pop(f2); d.pop(f3); d.pop(t); d.pop(r);
+		cc.setFlop(f1, f2, f3);
+		if (i % 3 > 0)
+			cc.setTurn(t);
+		if (i % 3 > 1)
+			cc.setRiver(r);
+		
+		vector<Card> remaining;
+		Card c;
+		while (d.pop(c))
+			remaining.push_back(c);
+		
+		HoleCards h[hands];
+		unsigned int keys[hands];
+		
+		for (unsigned int j=0; j < hands; j++)
+		{
+			random_shuffle(remaining.begin(), remaining.end());
+			h[j].setCards(remaining[0], remaining[1]);
+		}
+		
+		GameLogic::evaluateBatch(&cc, h, hands, keys);
+		
+		for (unsigned int j=0; j < hands; j++)
+		{
+			HandStrength strength;
+			GameLogic::getStrength(&(h[j]), &cc, &strength);
+			
+			if (strength.getKey() != keys[j])
+				mismatches++;
+		}
+	}
+	
+	printf("Batch evaluator (%s): %d boards, %d mismatches\n",
+		HandEvaluator::hasSIMD() ? "SIMD" : "scalar", boards, mismatches);
+	
+	return mismatches ? 1 : 0;
+}
+
+int test_evaluator3()
+{
+	// compare street-incremental board context with full evaluation
+	const unsigned int boards = 10000;
+	unsigned int mismatches = 0;
+	
+	ChaCha20 rng;
+	for (unsigned int i=0; i < boards; i++)
+	{
+		Deck d(rng);
+		d.fill();
+		d.shuffle();
+		
+		Card f1, f2, f3, t, r, h1, h2;
+		d.pop(f1); d.pop(f2); d.pop(f3); d.pop(t); d.pop(r);
+		d.pop(h1); d.pop(h2);
+		
+		HoleCards h;
+		h.setCards(h1, h2);
+		
+		CommunityCards cc;
+		BoardContext board;
+		cc.setFlop(f1, f2, f3);
+		board.add(f1); board.add(f2); board.add(f3);
+		
+		for (unsigned int street=0; street < 3; street++)
+		{
+			if (street == 1)
+			{
+				// what-if evaluation before the turn is dealt
+				HandStrength next, full;
+				BoardContext next_board = board.withCard(t);
+				GameLogic::getStrength(&h, &next_board, &next);
+				
+				cc.setTurn(t);
+				board.add(t);
+				GameLogic::getStrength(&h, &cc, &full);
+				
+				if (next.getKey() != full.getKey())
+					mismatches++;
+			}
+			else if (street == 2)
+			{
+				cc.setRiver(r);
+				board.add(r);
+			}
+			
+			HandStrength incr, full;
+			GameLogic::getStrength(&h, &board, &incr);
+			GameLogic::getStrength(&h, &cc, &full);
+			
+			if (incr.getKey() != full.getKey())
+				mismatches++;
+		}
+	}
+	
+	printf("Board context: %d boards, %d mismatches\n", boards, mismatches);
+	
+	return mismatches ? 1 : 0;
+}
+
+// best 5-card key of 7 cards, by evaluating all 21 subsets
+template <class E>
+static unsigned int best_of_seven(const Card *cards)
+{
+	unsigned int best = 0;
+	
+	for (unsigned int a=0; a < 7; a++)
+		for (unsigned int b=a+1; b < 7; b++)
+		{
+			Card five[5];
+			unsigned int n = 0;
+			for (unsigned int i=0; i < 7; i++)
+				if (i != a && i != b)
+					five[n++] = cards[i];
+			
+			const unsigned int key = E::evaluate(five, 5);
+			if (key > best)
+				best = key;
+		}
+	
+	return best;
+}
+
+int test_evaluator4()
+{
+	// full-deck 5-card hands by category, and the number of distinct hands
+	static const unsigned int expected[] = {
+		1302540, 1098240, 123552, 54912, 10200, 3744, 5108, 624, 40
+	};
+	unsigned int categories[9] = { 0 };
+	vector<unsigned int> keys;
+	unsigned int mismatches = 0;
+	
+	ChaCha20 rng;
+	Deck d(rng);
+	d.fill(FullDeck::FirstFace);
+	vector<Card> cards;
+	Card c;
+	while (d.pop(c))
+		cards.push_back(c);
+	
+	Card hand[5];
+	for (unsigned int a=0; a < 52; a++)
+	 for (unsigned int b=a+1; b < 52; b++)
+	  for (unsigned int c=b+1; c < 52; c++)
+	   for (unsigned int e=c+1; e < 52; e++)
+	    for (unsigned int f=e+1; f < 52; f++)
+	    {
+		hand[0] = cards[a]; hand[1] = cards[b]; hand[2] = cards[c];
+		hand[3] = cards[e]; hand[4] = cards[f];
+		
+		const unsigned int key = FullDeckEvaluator::evaluate(hand, 5);
+		categories[FullDeckEvaluator::getRanking(key)]++;
+		keys.push_back(key);
+	    }
+	
+	for (unsigned int i=0; i < 9; i++)
+		if (categories[i] != expected[i])
+			mismatches++;
+	
+	sort(keys.begin(), keys.end());
+	const unsigned int distinct = unique(keys.begin(), keys.end()) - keys.begin();
+	if (distinct != 7462)
+		mismatches++;
+	
+	// 7-card keys must equal the best of their 5-card subsets
+	for (unsigned int i=0; i < 100000; i++)
+	{
+		Card seven[7];
+		
+		d.fill(FullDeck::FirstFace);
+		d.shuffle();
+		for (unsigned int j=0; j < 7; j++)
+			d.pop(seven[j]);
+		
+		if (FullDeckEvaluator::evaluate(seven, 7) != best_of_seven<FullDeckEvaluator>(seven))
+			mismatches++;
+		
+		d.fill();
+		d.shuffle();
+		for (unsigned int j=0; j < 7; j++)
+			d.pop(seven[j]);
+		
+		if (HandEvaluator::evaluate(seven, 7) != best_of_seven<HandEvaluator>(seven))
+			mismatches++;
+	}
+	
+	printf("Variants: %d distinct full-deck hands, %d mismatches\n", distinct, mismatches);
+	
+	return mismatches ? 1 : 0;
+}
+
+
+int test_equity1()
+{
+	unsigned int errors = 0;
+	
+	EquityRequest req;
+	req.holes.resize(2);
+	req.holes[0].add(Card("As")); req.holes[0].add(Card("Kd"));
+	req.holes[1].add(Card("Qh")); req.holes[1].add(Card("Qc"));
+	req.board.add(Card("7s")); req.board.add(Card("8s"));
+	req.board.add(Card("Td")); req.board.add(Card("6c"));
+	req.trials = 200000;
+	req.seed = 42;
+	
+	// exact turn equity over all rivers
+	double exact = 0;
+	unsigned int rivers = 0;
+	const CardSet used = req.board | req.holes[0] | req.holes[1];
+	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		for (int su=Card::FirstSuit; su <= Card::LastSuit; su++)
+		{
+			Card r((Card::Face)f, (Card::Suit)su);
+			if (used.contains(r))
+				continue;
+			
+			vector<Card> cards;
+			req.board.copyCards(&cards);
+			cards.push_back(r);
+			
+			BoardContext board;
+			for (unsigned int i=0; i < cards.size(); i++)
+				board.add(cards[i]);
+			
+			const unsigned int k0 = board.evaluate(Card("As"), Card("Kd"));
+			const unsigned int k1 = board.evaluate(Card("Qh"), Card("Qc"));
+			exact += (k0 > k1) ? 1 : (k0 == k1) ? 0.5 : 0;
+			rivers++;
+		}
+	exact /= rivers;
+	
+	EquityEngine engine(4), single(1);
+	EquityResult res, res1;
+	
+	if (!engine.calculate(req, &res) || !single.calculate(req, &res1))
+		errors++;
+	else
+	{
+		// few enough rivers to enumerate
+		const EquityResult::Player &p = res.players[0];
+		if (!res.exact || res.trials != rivers || fabs(p.equity - exact) > 1e-9)
+			errors++;
+		
+		if (fabs(p.equity + res.players[1].equity - 1) > 1e-9)
+			errors++;
+		
+		// same seed, same result regardless of thread count
+		if (p.equity != res1.players[0].equity || res.trials != res1.trials)
+			errors++;
+		
+		printf("Equity: %.4f +- %.4f (exact %.4f) on %d threads\n",
+			p.equity, p.stderror, exact, engine.getThreadCount());
+	}
+	
+	// complete board: no randomness left
+	req.board.add(Card("9c"));
+	if (!engine.calculate(req, &res) || res.players[0].stderror != 0
+		|| (res.players[0].equity != 0 && res.players[0].equity != 1 && res.players[0].equity != 0.5))
+		errors++;
+	
+	// unknown hole-cards are drawn at random
+	req.holes[1].clear();
+	if (!engine.calculate(req, &res) || res.players[1].stderror == 0)
+		errors++;
+	
+	// overlapping cards are rejected
+	req.holes[1].add(Card("As"));
+	if (engine.calculate(req, &res))
+		errors++;
+	
+	// so are cards outside of the short deck
+	req.holes[1].clear();
+	req.holes[1].add(Card("2c")); req.holes[1].add(Card("3d"));
+	if (engine.calculate(req, &res))
+		errors++;
+	
+	req.holes[1].clear();
+	req.dead.add(Card("5h"));
+	if (engine.calculate(req, &res))
+		errors++;
+	
+	printf("Equity: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+// exact heads-up equity of player 0 by dealing every runout
+static double brute_equity(const CardSet &h0, const CardSet &h1, const CardSet &board)
+{
+	vector<Card> stub, b, c0, c1;
+	const CardSet used = h0 | h1 | board;
+	for (int f=Card::FirstFace; f <= Card::LastFace; f++)
+		for (int su=Card::FirstSuit; su <= Card::LastSuit; su++)
+		{
+			Card c((Card::Face)f, (Card::Suit)su);
+			if (!used.contains(c))
+				stub.push_back(c);
+		}
+	board.copyCards(&b);
+	h0.copyCards(&c0);
+	h1.copyCards(&c1);
+	
+	const unsigned int k = 5 - b.size();
+	double sum = 0;
+	unsigned long runouts = 0;
+	
+	vector<bool> pick(stub.size(), false);
+	fill(pick.begin(), pick.begin() + k, true);
+	do {
+		BoardContext ctx;
+		for (unsigned int i=0; i < b.size(); i++)
+			ctx.add(b[i]);
+		for (unsigned int i=0; i < stub.size(); i++)
+			if (pick[i])
+				ctx.add(stub[i]);
+		
+		const unsigned int k0 = ctx.evaluate(c0[0], c0[1]);
+		const unsigned int k1 = ctx.evaluate(c1[0], c1[1]);
+		sum += (k0 > k1) ? 1 : (k0 == k1) ? 0.5 : 0;
+		runouts++;
+	} while (prev_permutation(pick.begin(), pick.end()));
+	
+	return sum / runouts;
+}
+
+int test_equity2()
+{
+	unsigned int errors = 0;
+	EquityEngine engine;
+	EquityResult res;
+	
+	EquityRequest req;
+	req.holes.resize(2);
+	req.holes[0].add(Card("As")); req.holes[0].add(Card("Ks"));
+	req.holes[1].add(Card("Qd")); req.holes[1].add(Card("Jd"));
+	
+	// preflop; clubs and hearts are interchangeable
+	const double exact = brute_equity(req.holes[0], req.holes[1], req.board);
+	
+	req.trials = 250000;
+	if (!engine.calculate(req, &res) || !res.exact || res.trials != 201376
+		|| res.evaluated >= res.trials || fabs(res.players[0].equity - exact) > 1e-9)
+		errors++;
+	
+	printf("Equity: preflop %.4f exact, %lu of %lu runouts evaluated\n",
+		res.players[0].equity, res.evaluated, res.trials);
+	
+	// too many runouts for the trials; sampled
+	req.trials = 100000;
+	req.seed = 7;
+	if (!engine.calculate(req, &res) || res.exact
+		|| fabs(res.players[0].equity - exact) > 4 * res.players[0].stderror)
+		errors++;
+	
+	// flop with a suit to spare
+	req.board.add(Card("6h")); req.board.add(Card("9h")); req.board.add(Card("Th"));
+	const double flop = brute_equity(req.holes[0], req.holes[1], req.board);
+	if (!engine.calculate(req, &res) || !res.exact || res.trials != 406
+		|| fabs(res.players[0].equity - flop) > 1e-9)
+		errors++;
+	
+	printf("Equity: %d enumeration errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_equity3()
+{
+	unsigned int errors = 0;
+	EquityEngine engine;
+	EquityResult plain, strat, early, reference;
+	
+	EquityRequest req;
+	req.holes.resize(2);
+	req.holes[0].add(Card("As")); req.holes[0].add(Card("Kd"));
+	req.holes[1].add(Card("Qh")); req.holes[1].add(Card("Qc"));
+	req.trials = 100000;
+	req.seed = 3;
+	
+	// stratifying the first card must not widen the error
+	req.stratify = false;
+	engine.calculate(req, &plain);
+	req.stratify = true;
+	engine.calculate(req, &strat);
+	
+	if (strat.players[0].stderror > plain.players[0].stderror ||
+		fabs(strat.players[0].equity - plain.players[0].equity) >
+			4 * (strat.players[0].stderror + plain.players[0].stderror))
+		errors++;
+	
+	printf("Equity: stderr %.5f plain, %.5f stratified\n",
+		plain.players[0].stderror, strat.players[0].stderror);
+	
+	// stop at +-1% with an unknown opponent on the turn
+	req.holes[1].clear();
+	req.board.add(Card("7s")); req.board.add(Card("8s"));
+	req.board.add(Card("Td")); req.board.add(Card("Qd"));
+	req.trials = 2000000;
+	req.tolerance = 0.01;
+	
+	if (!engine.calculate(req, &early) || early.trials >= req.trials
+		|| 1.96 * early.players[0].stderror > req.tolerance)
+		errors++;
+	
+	req.tolerance = 0;
+	req.trials = 1000000;
+	engine.calculate(req, &reference);
+	if (fabs(early.players[0].equity - reference.players[0].equity) > 2 * 0.01)
+		errors++;
+	
+	printf("Equity: %.4f after %lu trials (%.4f after %lu), %d errors\n",
+		early.players[0].equity, early.trials,
+		reference.players[0].equity, reference.trials, errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_preflop1()
+{
+	unsigned int errors = 0;
+	
+	// hand indices cover 0..Hands-1 once, in either card order
+	vector<bool> seen(PreflopEquity::Hands, false);
+	for (unsigned int i=0; i < PreflopEquity::Cards; i++)
+		for (unsigned int j=0; j < i; j++)
+		{
+			Card c1((Card::Face)(Card::FirstFace + i / 4), (Card::Suit)(Card::FirstSuit + i % 4));
+			Card c2((Card::Face)(Card::FirstFace + j / 4), (Card::Suit)(Card::FirstSuit + j % 4));
+			
+			const unsigned int h = PreflopEquity::getHandIndex(c1, c2);
+			if (h >= PreflopEquity::Hands || seen[h] || h != PreflopEquity::getHandIndex(c2, c1))
+				errors++;
+			else
+				seen[h] = true;
+		}
+	
+	// a database with one matchup class
+	const char *filename = "test_preflop.db";
+	const Card a1("As"), a2("Kd"), b1("Qh"), b2("Qc");
+	const unsigned int a = PreflopEquity::getHandIndex(a1, a2);
+	const unsigned int b = PreflopEquity::getHandIndex(b1, b2);
+	
+	PreflopEquity::Header header;
+	PreflopEquity::fillHeader(&header, 1, 1000);
+	vector<uint16_t> matchups(PreflopEquity::Hands * PreflopEquity::Hands, PreflopEquity::NoMatchup);
+	matchups[a * PreflopEquity::Hands + b] = 0;
+	PreflopEquity::Entry entry = { 400, 100 };
+	
+	FILE *fp = fopen(filename, "wb");
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(&matchups[0], sizeof(uint16_t), matchups.size(), fp);
+	fwrite(&entry, sizeof(entry), 1, fp);
+	fclose(fp);
+	
+	PreflopEquity db;
+	double equity, tie;
+	
+	if (!db.load(filename) || !db.lookup(a1, a2, b1, b2, &equity, &tie)
+		|| equity != 0.45 || tie != 0.1 || db.lookup(b1, b2, a1, a2, &equity))
+		errors++;
+	
+	// truncated file
+	fp = fopen(filename, "wb");
+	fwrite(&header, sizeof(header), 1, fp);
+	fclose(fp);
+	
+	if (db.load(filename) || db.isLoaded() || db.lookup(a, b, &equity))
+		errors++;
+	
+	// class without an entry
+	matchups[a * PreflopEquity::Hands + b] = 1;
+	fp = fopen(filename, "wb");
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(&matchups[0], sizeof(uint16_t), matchups.size(), fp);
+	fwrite(&entry, sizeof(entry), 1, fp);
+	fclose(fp);
+	
+	if (db.load(filename) || db.isLoaded())
+		errors++;
+	
+	remove(filename);
+	
+	printf("Preflop equity: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_range1()
+{
+	unsigned int errors = 0;
+	
+	static const struct {
+		const char *str;
+		unsigned int combos;
+		double weight;
+	} ranges[] = {
+		{ "AA", 6, 6 },
+		{ "KQs+", 4, 4 },
+		{ "TT+", 30, 30 },
+		{ "99-77", 18, 18 },
+		{ "A9s-A7s", 12, 12 },
+		{ "KTo+", 36, 36 },
+		{ " AsKd , T9 ", 17, 17 },
+		{ "AK:0.5,AKs", 16, 10 },
+		{ "AA,AsAd:0", 5, 5 },
+		{ "66+,A6+,K6+", 54 + 8 * 16 + 7 * 16, 294 },
+	};
+	
+	for (unsigned int i=0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+	{
+		Range r;
+		if (!r.parse(ranges[i].str) || r.count() != ranges[i].combos
+			|| fabs(r.getTotalWeight() - ranges[i].weight) > 1e-9)
+		{
+			printf("Range '%s': %d combos\n", ranges[i].str, r.count());
+			errors++;
+		}
+	}
+	
+	static const char *invalid[] = {
+		"", "AAs", "ZZ", "A", "AK,,KQ", "99-8", "A9s-K7s", "A9s-A7o", "AK:x", "AsAs", "5s5d"
+	};
+	
+	for (unsigned int i=0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+	{
+		Range r;
+		if (r.parse(invalid[i]))
+		{
+			printf("Range '%s' accepted\n", invalid[i]);
+			errors++;
+		}
+	}
+	
+	// cards outside of the short deck are refused by add() as well
+	Range direct;
+	if (direct.add(Card("2c"), Card("Ah")) || direct.add(Card("Ah"), Card("5d"))
+		|| direct.count() || !direct.add(Card("6c"), Card("Ah")) || direct.count() != 1)
+		errors++;
+	
+	
+	// hand against a range equals the weighted mean of the matchups
+	EquityEngine engine;
+	EquityRequest req;
+	req.board.add(Card("7s")); req.board.add(Card("8s"));
+	req.board.add(Card("Td")); req.board.add(Card("Qd"));
+	
+	Range hero, villain;
+	hero.parse("AsKd");
+	villain.parse("QQ,JTs:0.5,99");
+	
+	double expected = 0, total = 0;
+	for (unsigned int i=0; i < villain.count(); i++)
+	{
+		const Range::Combo &c = villain.getCombos()[i];
+		if (c.cards.intersects(req.board | hero.getCombos()[0].cards))
+			continue;
+		
+		EquityRequest single = req;
+		single.holes.push_back(hero.getCombos()[0].cards);
+		single.holes.push_back(c.cards);
+		
+		EquityResult res;
+		engine.calculate(single, &res);
+		expected += c.weight * res.players[0].equity;
+		total += c.weight;
+	}
+	expected /= total;
+	
+	req.ranges.push_back(hero);
+	req.ranges.push_back(villain);
+	req.trials = 200000;
+	req.seed = 11;
+	
+	EquityResult res;
+	if (!engine.calculate(req, &res) || res.exact
+		|| fabs(res.players[0].equity - expected) > 4 * res.players[0].stderror
+		|| fabs(res.players[0].equity + res.players[1].equity - 1) > 1e-9)
+		errors++;
+	
+	printf("Range equity: %.4f +- %.4f (expected %.4f)\n",
+		res.players[0].equity, res.players[0].stderror, expected);
+	
+	// card removal between the ranges
+	req.ranges[0].parse("AA,KK:0.5");
+	req.ranges[1].parse("AK,JTs");
+	
+	expected = 0, total = 0;
+	for (unsigned int i=0; i < req.ranges[0].count(); i++)
+		for (unsigned int j=0; j < req.ranges[1].count(); j++)
+		{
+			const Range::Combo &a = req.ranges[0].getCombos()[i];
+			const Range::Combo &b = req.ranges[1].getCombos()[j];
+			if (a.cards.intersects(b.cards) || b.cards.intersects(req.board))
+				continue;
+			
+			EquityRequest single;
+			single.board = req.board;
+			single.holes.push_back(a.cards);
+			single.holes.push_back(b.cards);
+			
+			EquityResult r;
+			engine.calculate(single, &r);
+			expected += a.weight * b.weight * r.players[0].equity;
+			total += a.weight * b.weight;
+		}
+	expected /= total;
+	
+	if (!engine.calculate(req, &res) || fabs(res.players[0].equity - expected) > 4 * res.players[0].stderror)
+		errors++;
+	
+	printf("Range equity: %.4f +- %.4f (expected %.4f)\n",
+		res.players[0].equity, res.players[0].stderror, expected);
+	
+	// ranges that never fit together
+	req.ranges[0].parse("AsAd");
+	req.ranges[1].parse("AsAh");
+	if (engine.calculate(req, &res))
+		errors++;
+	
+	// cards outside of the short deck
+	req.ranges[1].parse("KK");
+	req.dead.add(Card("2c"));
+	if (engine.calculate(req, &res))
+		errors++;
+	
+	printf("Range: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_equitycache1()
+{
+	unsigned int errors = 0;
+	
+	EquityEngine engine;
+	EquityCache cache(&engine, 16 * 4);
+	EquityCache::Stats stats;
+	
+	EquityRequest req;
+	req.holes.resize(2);
+	req.holes[0].add(Card("As")); req.holes[0].add(Card("Ks"));
+	req.holes[1].add(Card("Qd")); req.holes[1].add(Card("Qh"));
+	req.board.add(Card("7c")); req.board.add(Card("8c")); req.board.add(Card("9d"));
+	req.trials = 1000;
+	req.seed = 1;
+	
+	EquityResult res1, res2;
+	cache.calculate(req, &res1);
+	
+	// the same spot with spades and hearts, clubs and diamonds swapped
+	EquityRequest iso = req;
+	iso.holes[0].clear(); iso.holes[1].clear(); iso.board.clear();
+	iso.holes[0].add(Card("Ah")); iso.holes[0].add(Card("Kh"));
+	iso.holes[1].add(Card("Qc")); iso.holes[1].add(Card("Qs"));
+	iso.board.add(Card("7d")); iso.board.add(Card("8d")); iso.board.add(Card("9c"));
+	cache.calculate(iso, &res2);
+	
+	cache.getStats(&stats);
+	if (stats.hits != 1 || stats.misses != 1 || res1.players[0].equity != res2.players[0].equity)
+		errors++;
+	
+	// other players' order or trial count is another entry
+	swap(iso.holes[0], iso.holes[1]);
+	cache.calculate(iso, &res2);
+	req.trials = 2000;
+	cache.calculate(req, &res2);
+	
+	cache.getStats(&stats);
+	if (stats.hits != 1 || stats.misses != 3)
+		errors++;
+	
+	// fill beyond capacity
+	for (unsigned int i=0; i < 200; i++)
+	{
+		req.trials = 100 + i;
+		cache.calculate(req, &res2);
+	}
+	
+	cache.getStats(&stats);
+	if (!stats.evictions || stats.entries > 16 * 4 || stats.entries + stats.evictions != stats.misses)
+		errors++;
+	
+	printf("Equity cache: %lu hits, %lu misses, %lu evictions, %d errors\n",
+		stats.hits, stats.misses, stats.evictions, errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_equityworker1()
+{
+	unsigned int errors = 0;
+	EquityWorker worker;
+	
+	EquityWorker::Job job;
+	job.game_id = 1;
+	job.table_id = 0;
+	job.players.push_back(10);
+	job.players.push_back(20);
+	job.request.holes.resize(2);
+	job.request.holes[0].add(Card("As")); job.request.holes[0].add(Card("Kd"));
+	job.request.holes[1].add(Card("Qh")); job.request.holes[1].add(Card("Qc"));
+	job.request.trials = 20000;
+	
+	// a newer job of the same table replaces the pending one
+	job.betround = 0;
+	const unsigned int first = worker.submit(job);
+	job.betround = 1;
+	job.request.board.add(Card("7s")); job.request.board.add(Card("8s")); job.request.board.add(Card("Td"));
+	const unsigned int second = worker.submit(job);
+	
+	// another game's job, cancelled
+	job.game_id = 2;
+	worker.submit(job);
+	worker.cancel(2);
+	
+	vector<EquityWorker::Result> results;
+	for (unsigned int i=0; i < 1000 && (results.empty() || results.back().id != second); i++)
+	{
+		worker.collect(1, &results);
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	
+	if (results.empty() || results.back().id != second || results.back().betround != 1
+		|| results.back().players.size() != 2 || !results.back().result.exact)
+		errors++;
+	
+	// the replaced job is never delivered, even if it was already running
+	for (unsigned int i=0; i < results.size(); i++)
+		if (results[i].id == first)
+			errors++;
+	
+	results.clear();
+	if (worker.collect(2, &results))
+		errors++;
+	
+	printf("Equity worker: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+unsigned int TestCaseGameController::allinequity1()
+{
+	unsigned int errors = 0;
+	
+	EquityWorker worker;
+	GameController::setEquityWorker(&worker);
+	
+	GameController g;
+	Table t;
+	t.setTableId(0);
+	g.tables[0] = &t;
+	
+	// heads-up: seat 0 shoved preflop, seat 1 called
+	static const char *holes[][2] = { { "As", "Ks" }, { "Qh", "Qc" } };
+	for (unsigned int i=0; i < 2; i++)
+	{
+		shared_ptr<Player> p = make_shared<Player>();
+		p->client_id = i;
+		p->stake = 0;
+		p->holecards.setCards(Card(holes[i][0]), Card(holes[i][1]));
+		g.players[i] = p;
+		
+		Seat &seat = t.seats[i];
+		seat.seat_no = i;
+		seat.occupied = true;
+		seat.in_round = true;
+		seat.bet = 1000;
+		seat.player = p;
+	}
+	
+	Table::Pot pot;
+	pot.amount = 0;
+	pot.final = false;
+	t.pots.push_back(pot);
+	
+	t.deck.fill();
+	t.state = Table::Betting;
+	t.betround = Table::Preflop;
+	t.nomoreaction = false;
+	t.dealer = t.sb = 0;
+	t.bb = 1;
+	t.cur_player = 1;
+	t.last_bet_player = 0;
+	t.bet_amount = 1000;
+	t.last_bet_amount = 0;
+	
+	// the call ends the betting; the flop waits for the preflop equity
+	equity_snapshots.clear();
+	g.stateBetting(&t);
+	
+	if (!t.nomoreaction || t.communitycards.size() || t.state != Table::Betting || !t.delay)
+		errors++;
+	
+	for (unsigned int i=0; i < 1000 && equity_snapshots.empty(); i++)
+	{
+		g.publishEquity();
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	
+	// one per player
+	if (equity_snapshots.size() != 2)
+		errors++;
+	
+	for (unsigned int i=0; i < equity_snapshots.size(); i++)
+	{
+		int betround = -1;
+		if (sscanf(equity_snapshots[i].c_str(), "%d", &betround) != 1 || betround != Table::Preflop)
+			errors++;
+	}
+	
+	// next tick deals the flop
+	t.delay = 0;
+	g.stateBetting(&t);
+	
+	if (t.communitycards.size() != 3 || t.betround != Table::Flop)
+		errors++;
+	
+	GameController::setEquityWorker(NULL);
+	
+	return errors;
+}
+
+int test_allinequity1()
+{
+	const unsigned int errors = TestCaseGameController::allinequity1();
+	
+	printf("All-in equity: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
+
+int test_handstats1()
+{
+	unsigned int errors = 0;
+	
+	HoleCards holes[2];
+	holes[0].setCards(Card("As"), Card("Ks"));
+	holes[1].setCards(Card("7d"), Card("7c"));
+	
+	CommunityCards cc;
+	cc.setFlop(Card("Qs"), Card("Js"), Card("7h"));
+	cc.setTurn(Card("Ts"));
+	cc.setRiver(Card("6d"));
+	
+	HandStatistics a, b;
+	if (!a.add(holes, 2, &cc))
+		errors++;
+	
+	b.merge(a);
+	b.merge(a);
+	
+	if (b.getHands() != 2 || b.getPlayerHands() != 4
+		|| b.getCategory(HandStrength::StraightFlush) != 2
+		|| b.getCategory(HandStrength::ThreeOfAKind) != 2
+		|| b.getBoardCategory(HandStrength::HighCard) != 2
+		|| b.getFlopTexture(HandStatistics::TwoTone) != 2 || b.getPairedFlops()
+		|| b.getCardCount(0, (Card::Ace - Card::FirstFace) * 4 + (Card::Spades - Card::FirstSuit)) != 2)
+		errors++;
+	
+	// incomplete board
+	cc.clear();
+	cc.setFlop(Card("Qs"), Card("Js"), Card("7h"));
+	if (a.add(holes, 2, &cc) || a.getHands() != 1)
+		errors++;
+	
+	// checkpoint round trip
+	const char *filename = "test_handstats.txt";
+	HandStatistics c;
+	if (!b.save(filename) || !c.load(filename) || c.getHands() != 2
+		|| c.getCategory(HandStrength::StraightFlush) != 2 || c.getChiSquare(0) != b.getChiSquare(0))
+		errors++;
+	remove(filename);
+	
+	if (c.load(filename) || c.getHands() != 2)
+		errors++;
+	
+	printf("Hand statistics: %d errors\n", errors);
+	
+	return errors ? 1 : 0;
+}
+
 
 int main(void)
 {
@@ -286,5 +1615,14 @@ int main(void)
 	test_winlist1();
 #endif
 
+#if 1
+	if (test_card4() || test_chacha1() || test_deck2() || test_deckpool1() || test_holecards1()
+		|| test_winlist2() || test_showdown1() || test_evaluator1() || test_evaluator2() || test_evaluator3() || test_evaluator4()
+		|| test_equity1() || test_equity2() || test_equity3()
+		|| test_preflop1() || test_range1()
+		|| test_equitycache1() || test_equityworker1() || test_allinequity1() || test_handstats1())
+		return 1;
+#endif
+
 	return 0;
 }